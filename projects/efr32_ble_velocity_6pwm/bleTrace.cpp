@@ -0,0 +1,481 @@
+/***************************************************************************//**
+ * @file bleTrace.cpp
+ * @brief BLE traffic record and replay implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "bleTrace.h"
+#include "task.h"
+
+static const size_t trace_header_size = 6u;
+
+// LEB128 helpers
+static size_t put_varint(uint8_t *out, uint32_t value)
+{
+  size_t n = 0;
+  do {
+    uint8_t byte = value & 0x7Fu;
+    value >>= 7;
+    out[n++] = value ? (byte | 0x80u) : byte;
+  } while (value);
+  return n;
+}
+
+static bool get_varint(const uint8_t *in, size_t size, size_t &pos, uint32_t &value)
+{
+  value = 0u;
+  for (uint8_t shift = 0u; shift < 35u && pos < size; shift += 7u) {
+    uint8_t byte = in[pos++];
+    value |= (uint32_t)(byte & 0x7Fu) << shift;
+    if (!(byte & 0x80u)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int hex_value(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// Recorder
+bleTraceRecorder::bleTraceRecorder() :
+  _len(0u),
+  _recording(false),
+  _last_us(0u),
+  _events(0u),
+  _dropped(0u)
+{
+}
+
+// record() runs on the BLE task, or on the comms task with deferred events.
+// The buffer state is only changed in critical sections.
+void bleTraceRecorder::start(uint8_t rx_flow_control, uint16_t data_handle)
+{
+  uint8_t header[trace_header_size] = {
+    'B', 'T', BLE_TRACE_VERSION, rx_flow_control,
+    (uint8_t)(data_handle & 0xFFu), (uint8_t)(data_handle >> 8)
+  };
+
+  taskENTER_CRITICAL();
+  _len = 0u;
+  _events = 0u;
+  _dropped = 0u;
+  append(header, sizeof(header));
+  _last_us = micros();
+  _recording = true;
+  taskEXIT_CRITICAL();
+}
+
+void bleTraceRecorder::stop()
+{
+  taskENTER_CRITICAL();
+  _recording = false;
+  taskEXIT_CRITICAL();
+}
+
+bool bleTraceRecorder::is_recording()
+{
+  return _recording;
+}
+
+void bleTraceRecorder::clear()
+{
+  taskENTER_CRITICAL();
+  _len = 0u;
+  _events = 0u;
+  _dropped = 0u;
+  taskEXIT_CRITICAL();
+}
+
+void bleTraceRecorder::record(sl_bt_msg_t *evt)
+{
+  if (!_recording || !evt) {
+    return;
+  }
+
+  size_t payload_len = SL_BT_MSG_LEN(evt->header);
+
+  taskENTER_CRITICAL();
+
+  if (!_recording) {
+    // Stopped meanwhile
+  } else if (_dropped) {
+    // Once an event is lost the trace is kept as the recorded prefix
+    _dropped++;
+  } else {
+    uint32_t now = micros();
+    uint8_t rec[5u + sizeof(uint32_t)];
+    size_t rec_len = put_varint(rec, now - _last_us);
+    for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+      rec[rec_len++] = (uint8_t)(evt->header >> (8u * i));
+    }
+
+    if (_len + rec_len + payload_len > BLE_TRACE_BUFFER_SIZE) {
+      _dropped++;
+    } else {
+      append(rec, rec_len);
+      append((const uint8_t *)&evt->data, payload_len);
+      _last_us = now;
+      _events++;
+    }
+  }
+
+  taskEXIT_CRITICAL();
+}
+
+void bleTraceRecorder::dump(Print &out)
+{
+  // The recorded part does not change while recording continues
+  size_t len = _len;
+  for (size_t i = 0; i < len; i += BLE_TRACE_LINE_SIZE) {
+    out.print("RL");
+    for (size_t j = i; j < i + BLE_TRACE_LINE_SIZE && j < len; ++j) {
+      if (_buf[j] < 0x10u) {
+        out.print('0');
+      }
+      out.print(_buf[j], HEX);
+    }
+    out.println();
+  }
+}
+
+bool bleTraceRecorder::load_hex(const char *hex)
+{
+  if (!hex) {
+    return false;
+  }
+
+  // One Commander line, at most a few bytes
+  uint8_t bytes[BLE_TRACE_LINE_SIZE];
+  size_t count = 0;
+  while (hex[0] && hex[0] != '\r' && hex[0] != '\n') {
+    int hi = hex_value(hex[0]);
+    int lo = hi < 0 ? -1 : hex_value(hex[1]);
+    if (lo < 0 || count >= sizeof(bytes)) {
+      return false;
+    }
+    bytes[count++] = (uint8_t)((hi << 4) | lo);
+    hex += 2;
+  }
+
+  taskENTER_CRITICAL();
+  bool loaded = !_recording && append(bytes, count);
+  taskEXIT_CRITICAL();
+
+  return loaded;
+}
+
+const uint8_t *bleTraceRecorder::get_data()
+{
+  return _buf;
+}
+
+size_t bleTraceRecorder::get_size()
+{
+  return _len;
+}
+
+uint32_t bleTraceRecorder::get_events()
+{
+  return _events;
+}
+
+uint32_t bleTraceRecorder::get_dropped()
+{
+  return _dropped;
+}
+
+bool bleTraceRecorder::append(const uint8_t *data, size_t len)
+{
+  if (_len + len > BLE_TRACE_BUFFER_SIZE) {
+    return false;
+  }
+  memcpy(&_buf[_len], data, len);
+  _len = _len + len;
+  return true;
+}
+
+// Replayer
+bleTraceReplayer::bleTraceReplayer() :
+  sppBLEClass(),
+  _trace(nullptr),
+  _size(0u),
+  _pos(0u),
+  _speed(REPLAY_MAX),
+  _running(false),
+  _start_us(0u),
+  _event_us(0u),
+  _open_connections(0u),
+  _stats(),
+  user_onreplaydata_callback(nullptr)
+{
+}
+
+bool bleTraceReplayer::start(const uint8_t *trace, size_t size, replay_speed_t speed)
+{
+  stop();
+
+  if (!trace || size < trace_header_size
+      || trace[0] != 'B' || trace[1] != 'T' || trace[2] != BLE_TRACE_VERSION) {
+    return false;
+  }
+
+  // Same flow control and data attribute as the recorded GATT DB
+  set_rx_flow_control((rx_flow_control_t)trace[3]);
+  set_data_characteristic_handle((uint16_t)(trace[4] | (trace[5] << 8)));
+
+  while (available()) {
+    read();
+  }
+
+  _stats = replay_stats_t();
+  reset_event_stats();
+
+  _trace = trace;
+  _size = size;
+  _pos = trace_header_size;
+  _speed = speed;
+  _event_us = 0u;
+  _start_us = micros();
+  _running = true;
+
+  return true;
+}
+
+void bleTraceReplayer::stop()
+{
+  if (_running) {
+    _stats.duration_us = micros() - _start_us;
+    _running = false;
+  }
+  close_connections();
+}
+
+bool bleTraceReplayer::is_running()
+{
+  return _running;
+}
+
+size_t bleTraceReplayer::run(size_t max_events)
+{
+  size_t replayed = 0;
+
+  while (_running && replayed < max_events) {
+    if (_pos >= _size) {
+      stop();
+      break;
+    }
+
+    size_t pos = _pos;
+    uint32_t delta;
+    if (!get_varint(_trace, _size, pos, delta)) {
+      _stats.errors++;
+      stop();
+      break;
+    }
+
+    uint32_t due_us = _event_us + delta;
+    if (_speed == REPLAY_RECORDED) {
+      uint32_t elapsed = micros() - _start_us;
+      if ((int32_t)(elapsed - due_us) < 0) {
+        break;
+      }
+      if (elapsed - due_us > _stats.max_lag_us) {
+        _stats.max_lag_us = elapsed - due_us;
+      }
+    }
+
+    _pos = pos;
+    _event_us = due_us;
+
+    if (!replay_next()) {
+      _stats.errors++;
+      stop();
+      break;
+    }
+    replayed++;
+  }
+
+  return replayed;
+}
+
+void bleTraceReplayer::onReplayData(void (*user_onreplaydata_callback)(Stream&))
+{
+  if (!user_onreplaydata_callback) {
+    return;
+  }
+  this->user_onreplaydata_callback = user_onreplaydata_callback;
+}
+
+const bleTraceReplayer::replay_stats_t &bleTraceReplayer::get_replay_stats()
+{
+  return _stats;
+}
+
+void bleTraceReplayer::print_replay_stats(Print &out)
+{
+  out.print("replay events:");
+  out.print(_stats.events);
+  out.print(" errors:");
+  out.print(_stats.errors);
+  out.print(" notify:");
+  out.print(_stats.notifications);
+  out.print('/');
+  out.print(_stats.notified_bytes);
+  out.print("B wr_rsp:");
+  out.print(_stats.write_responses);
+  out.print(" time:");
+  out.print(_stats.events ? _stats.total_us / _stats.events : 0u);
+  out.print('/');
+  out.print(_stats.max_us);
+  out.print(" lag:");
+  out.print(_stats.max_lag_us);
+  out.print(" rx_hw:");
+  out.print(_stats.rx_high_water);
+  out.print(" tx_hw:");
+  out.print(_stats.tx_high_water);
+  out.print(" duration:");
+  out.print(_running ? micros() - _start_us : _stats.duration_us);
+  out.println(_running ? " running" : "");
+
+  print_event_stats(out);
+  print_rx_stats(out);
+}
+
+size_t bleTraceReplayer::send_data(uint8_t connection, uint16_t length, uint8_t *data)
+{
+  (void)connection;
+  (void)data;
+
+  if (!length) {
+    return 0;
+  }
+
+  _stats.notifications++;
+  _stats.notified_bytes += length;
+
+  uint32_t pending = (uint32_t)tx_available();
+  if (pending > _stats.tx_high_water) {
+    _stats.tx_high_water = pending;
+  }
+
+  return length;
+}
+
+void bleTraceReplayer::send_write_response(uint8_t connection, uint16_t characteristic, uint8_t att_error)
+{
+  (void)connection;
+  (void)characteristic;
+  (void)att_error;
+
+  _stats.write_responses++;
+}
+
+bool bleTraceReplayer::replay_next()
+{
+  if (_pos + sizeof(uint32_t) > _size) {
+    return false;
+  }
+
+  uint32_t header = 0u;
+  for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+    header |= (uint32_t)_trace[_pos++] << (8u * i);
+  }
+
+  size_t payload_len = SL_BT_MSG_LEN(header);
+  if (sizeof(header) + payload_len > event_size || _pos + payload_len > _size) {
+    return false;
+  }
+
+  sl_bt_msg_t *evt = (sl_bt_msg_t *)_evt.data;
+  _evt.header = header;
+  memcpy(&_evt.data[sizeof(header)], &_trace[_pos], payload_len);
+  _pos += payload_len;
+
+  switch (SL_BT_MSG_ID(header)) {
+    case sl_bt_evt_connection_opened_id:
+      _open_connections |= 1u << (evt->data.evt_connection_opened.connection & 0x1Fu);
+      break;
+
+    case sl_bt_evt_connection_closed_id:
+      _open_connections &= ~(1u << (evt->data.evt_connection_closed.connection & 0x1Fu));
+      break;
+
+    default:
+      break;
+  }
+
+  uint32_t start = micros();
+
+  handle_ble_event(evt);
+
+  uint32_t rx_level = (uint32_t)available();
+  if (rx_level > _stats.rx_high_water) {
+    _stats.rx_high_water = rx_level;
+  }
+
+  if (user_onreplaydata_callback) {
+    user_onreplaydata_callback(*this);
+  }
+
+  uint32_t elapsed = micros() - start;
+  _stats.events++;
+  _stats.total_us += elapsed;
+  if (elapsed > _stats.max_us) {
+    _stats.max_us = elapsed;
+  }
+
+  return true;
+}
+
+void bleTraceReplayer::close_connections()
+{
+  // Leave the target disconnected, as a new trace starts from scratch
+  for (uint8_t conn = 0u; _open_connections; ++conn) {
+    if (!(_open_connections & (1u << conn))) {
+      continue;
+    }
+    _open_connections &= ~(1u << conn);
+
+    sl_bt_msg_t *evt = (sl_bt_msg_t *)_evt.data;
+    memset(&_evt, 0, sizeof(_evt));
+    _evt.header = sl_bt_evt_connection_closed_id
+                  | ((uint32_t)sizeof(sl_bt_evt_connection_closed_t) << 8);
+    evt->data.evt_connection_closed.connection = conn;
+    handle_ble_event(evt);
+  }
+}
@@ -0,0 +1,153 @@
+/***************************************************************************//**
+ * @file bleTrace.h
+ * @brief BLE traffic record and replay header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+#include "sppBLE.h"
+
+#ifndef BLE_TRACE_BUFFER_SIZE
+#define BLE_TRACE_BUFFER_SIZE 4096u
+#endif
+
+#define BLE_TRACE_VERSION 1u
+
+#define BLE_TRACE_LINE_SIZE 8u  // Bytes per "RL" line of the hex dump
+
+// BLE traffic trace, little endian:
+//  header: 'B' 'T' version rx_flow_control data_handle[2]
+//  record: delta_us (LEB128) evt_header[4] payload[SL_BT_MSG_LEN(evt_header)]
+// The timestamp is taken when the event is handled, so in deferred mode the
+// trace shows the queue delay too.
+class bleTraceRecorder {
+public:
+  bleTraceRecorder();
+
+  // Clears the trace. The header lets the replay match the recorded GATT DB.
+  void start(uint8_t rx_flow_control, uint16_t data_handle);
+  void stop();
+  bool is_recording();
+  void clear();
+
+  // Call from the onBLEEvent callback. Stops silently when the buffer is full.
+  void record(sl_bt_msg_t *evt);
+
+  // Hex export / import, BLE_TRACE_LINE_SIZE bytes per "RL" line, so that
+  // the dump fits in Commander commands and can be sent back unchanged
+  void dump(Print &out);
+  bool load_hex(const char *hex);
+
+  const uint8_t *get_data();
+  size_t get_size();
+  uint32_t get_events();
+  uint32_t get_dropped();
+
+private:
+  bool append(const uint8_t *data, size_t len);
+
+  uint8_t _buf[BLE_TRACE_BUFFER_SIZE];
+  volatile size_t _len;
+  volatile bool _recording;
+  uint32_t _last_us;
+  uint32_t _events;
+  uint32_t _dropped;
+};
+
+// Replay target: the SPP class with a stubbed stack. Recorded events are fed
+// to handle_ble_event(), notifications and write responses are counted
+// instead of sent. Do not call begin(), the target has no GATT DB.
+class bleTraceReplayer : public sppBLEClass {
+public:
+  bleTraceReplayer();
+
+  enum replay_speed_t {
+    REPLAY_RECORDED = 0,  // Keep the recorded event timing
+    REPLAY_MAX,           // Back to back
+  };
+
+  bool start(const uint8_t *trace, size_t size, replay_speed_t speed);
+  void stop();
+  bool is_running();
+
+  // Call from loop(), replays the events which are due. Non-blocking.
+  size_t run(size_t max_events = 4u);
+
+  // Called after each event to consume the received data, e.g. by Commander
+  void onReplayData(void (*user_onreplaydata_callback)(Stream&));
+
+  struct replay_stats_t {
+    uint32_t events;
+    uint32_t errors;          // Malformed records, the replay is stopped
+    uint32_t notifications;
+    uint32_t notified_bytes;
+    uint32_t write_responses;
+    uint32_t total_us;        // Event handling and data consumption
+    uint32_t max_us;
+    uint32_t max_lag_us;      // Behind the recorded timing
+    uint32_t rx_high_water;   // [B]
+    uint32_t tx_high_water;   // [B]
+    uint32_t duration_us;
+  };
+
+  const replay_stats_t &get_replay_stats();
+  void print_replay_stats(Print &out);
+
+  virtual size_t send_data(uint8_t connection, uint16_t length, uint8_t *data) override;
+
+protected:
+  virtual void send_write_response(uint8_t connection, uint16_t characteristic, uint8_t att_error) override;
+
+private:
+  // No advertising on the stubbed stack
+  virtual void init_advertising() override {}
+  virtual void start_advertising() override {}
+  virtual void stop_advertising() override {}
+
+  bool replay_next();
+  void close_connections();
+
+  const uint8_t *_trace;
+  size_t _size;
+  size_t _pos;
+  replay_speed_t _speed;
+  bool _running;
+
+  uint32_t _start_us;
+  uint32_t _event_us;       // Recorded time of the next event
+  uint32_t _open_connections;  // Bit per connection handle, closed by stop()
+
+  // Aligned copy of the event under replay
+  union {
+    uint32_t header;
+    uint8_t data[event_size];
+  } _evt;
+
+  replay_stats_t _stats;
+  void (*user_onreplaydata_callback)(Stream&);
+};
@@ -88,11 +88,24 @@ for device in $BUILD_DEVICES; do
     echo "Build path: $build_path"
     echo "=========================================="
 
+    # Append -fstack-usage to the extra flags of the platform, a build
+    # property replaces the platform value
+    properties="$(arduino-cli compile \
+        --fqbn "$device" \
+        --board-options protocol_stack=ble_silabs \
+        --show-properties \
+        "$SKETCH_PATH" 2>/dev/null)"
+    c_flags="$(printf '%s\n' "$properties" | sed -n 's/^compiler\.c\.extra_flags=//p')"
+    cpp_flags="$(printf '%s\n' "$properties" | sed -n 's/^compiler\.cpp\.extra_flags=//p')"
+
     if arduino-cli compile \
         --fqbn "$device" \
         --board-options protocol_stack=ble_silabs \
+        --build-property "compiler.c.extra_flags=$c_flags -fstack-usage" \
+        --build-property "compiler.cpp.extra_flags=$cpp_flags -fstack-usage" \
         --build-path "$build_path" \
-        "$SKETCH_PATH"; then
+        "$SKETCH_PATH" \
+        && sh "$SCRIPT_DIR/memory_report.sh" "$build_path"; then
         echo "Successfully compiled for $device"
         success_count=$((success_count + 1))
     else
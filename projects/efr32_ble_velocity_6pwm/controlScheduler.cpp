@@ -0,0 +1,135 @@
+/***************************************************************************//**
+ * @file controlScheduler.cpp
+ * @brief Multi-rate control scheduler implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "controlScheduler.h"
+
+controlScheduler::controlScheduler() :
+  _tasks(),
+  _task_count(0u)
+{
+}
+
+bool controlScheduler::add_task(
+  const char *name,
+  uint32_t period_us,
+  uint32_t phase_us,
+  void (*callback)(void *),
+  void *arg
+  )
+{
+  if (_task_count >= SCHEDULER_MAX_TASKS || !callback || !period_us) {
+    return false;
+  }
+
+  task_t &task = _tasks[_task_count++];
+  task.name = name;
+  task.period_us = period_us;
+  task.phase_us = phase_us;
+  task.next_us = 0u;
+  task.callback = callback;
+  task.arg = arg;
+  task.stats = task_stats_t();
+
+  return true;
+}
+
+void controlScheduler::begin()
+{
+  uint32_t now = micros();
+  for (size_t i = 0; i < _task_count; ++i) {
+    _tasks[i].next_us = now + _tasks[i].phase_us;
+  }
+}
+
+void controlScheduler::run()
+{
+  for (size_t i = 0; i < _task_count; ++i) {
+    task_t &task = _tasks[i];
+
+    uint32_t now = micros();
+    int32_t late = (int32_t)(now - task.next_us);
+    if (late < 0) {
+      continue;
+    }
+
+    // Skip the releases which are already over
+    if ((uint32_t)late >= task.period_us) {
+      uint32_t missed = (uint32_t)late / task.period_us;
+      task.stats.overruns += missed;
+      task.next_us += missed * task.period_us;
+      late -= missed * task.period_us;
+    }
+    task.next_us += task.period_us;
+
+    task.callback(task.arg);
+
+    uint32_t exec = micros() - now;
+    task.stats.runs++;
+    if ((uint32_t)late > task.stats.max_late_us) {
+      task.stats.max_late_us = late;
+    }
+    if (exec > task.stats.max_exec_us) {
+      task.stats.max_exec_us = exec;
+    }
+  }
+}
+
+const controlScheduler::task_stats_t *controlScheduler::get_task_stats(size_t index)
+{
+  if (index >= _task_count) {
+    return nullptr;
+  }
+  return &_tasks[index].stats;
+}
+
+void controlScheduler::reset_stats()
+{
+  for (size_t i = 0; i < _task_count; ++i) {
+    _tasks[i].stats = task_stats_t();
+  }
+}
+
+void controlScheduler::print(Print &out)
+{
+  for (size_t i = 0; i < _task_count; ++i) {
+    const task_t &task = _tasks[i];
+    out.print("TASK ");
+    out.print(task.name);
+    out.print(" period:");
+    out.print(task.period_us);
+    out.print(" runs:");
+    out.print(task.stats.runs);
+    out.print(" overruns:");
+    out.print(task.stats.overruns);
+    out.print(" late:");
+    out.print(task.stats.max_late_us);
+    out.print(" exec:");
+    out.println(task.stats.max_exec_us);
+  }
+}
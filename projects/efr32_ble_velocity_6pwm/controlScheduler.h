@@ -0,0 +1,82 @@
+/***************************************************************************//**
+ * @file controlScheduler.h
+ * @brief Multi-rate control scheduler header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8u
+#endif
+
+// Fixed-rate cooperative scheduler, polled from loop(). Each task has a
+// period and a phase offset [us] and is released on a fixed time grid, so
+// the rate does not drift with the execution time of the other tasks. When
+// several tasks are due they run in the order they were added. A release
+// missed because the task was still waiting for an earlier one is counted as
+// an overrun and skipped, the task does not run in bursts to catch up.
+class controlScheduler {
+public:
+  controlScheduler();
+
+  // Add the tasks before begin(). Returns false when the table is full.
+  bool add_task(const char *name, uint32_t period_us, uint32_t phase_us,
+                void (*callback)(void *), void *arg = nullptr);
+
+  // Starts the time grid of every task
+  void begin();
+
+  // Call from loop(), runs the tasks which are due
+  void run();
+
+  struct task_stats_t {
+    uint32_t runs;
+    uint32_t overruns;    // Missed releases
+    uint32_t max_late_us; // Start time after the release
+    uint32_t max_exec_us;
+  };
+
+  const task_stats_t *get_task_stats(size_t index);
+  void reset_stats();
+  void print(Print &out);
+
+private:
+  struct task_t {
+    const char *name;
+    uint32_t period_us;
+    uint32_t phase_us;
+    uint32_t next_us;
+    void (*callback)(void *);
+    void *arg;
+    task_stats_t stats;
+  };
+
+  task_t _tasks[SCHEDULER_MAX_TASKS];
+  size_t _task_count;
+};
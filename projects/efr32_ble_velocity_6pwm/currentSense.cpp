@@ -0,0 +1,311 @@
+/***************************************************************************//**
+ * @file currentSense.cpp
+ * @brief Phase current sampling implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "currentSense.h"
+
+#if defined(ARDUINO_ARCH_SILABS)
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_iadc.h"
+#include "em_ldma.h"
+#include "em_prs.h"
+#include "dmadrv.h"
+#endif
+
+currentSenseClass currentSense;
+
+currentSenseClass::currentSenseClass() :
+  _lowside(),
+  _sim(),
+  _read_time()
+{
+}
+
+#if defined(ARDUINO_ARCH_SILABS)
+static LDMA_Descriptor_t lowside_descriptors[2];
+
+static void allocate_analog_bus(GPIO_Port_TypeDef port, uint8_t pin)
+{
+  bool even = (pin & 1u) == 0u;
+
+  switch (port) {
+    case gpioPortA:
+      GPIO->ABUSALLOC |= even ? GPIO_ABUSALLOC_AEVEN0_ADC0 : GPIO_ABUSALLOC_AODD0_ADC0;
+      break;
+
+    case gpioPortB:
+      GPIO->BBUSALLOC |= even ? GPIO_BBUSALLOC_BEVEN0_ADC0 : GPIO_BBUSALLOC_BODD0_ADC0;
+      break;
+
+    default:
+      GPIO->CDBUSALLOC |= even ? GPIO_CDBUSALLOC_CDEVEN0_ADC0 : GPIO_CDBUSALLOC_CDODD0_ADC0;
+      break;
+  }
+}
+
+void *currentSenseClass::configure_lowside(const int *pins, size_t count)
+{
+  if (count > _max_pins) {
+    return SIMPLEFOC_CURRENT_SENSE_INIT_FAILED;
+  }
+
+  CMU_ClockEnable(cmuClock_IADC0, true);
+  CMU_ClockEnable(cmuClock_PRS, true);
+  CMU_ClockSelectSet(cmuClock_IADCCLK, cmuSelect_FSRCO);
+
+  IADC_Init_t init = IADC_INIT_DEFAULT;
+  IADC_AllConfigs_t configs = IADC_ALLCONFIGS_DEFAULT;
+  IADC_InitScan_t scan = IADC_INITSCAN_DEFAULT;
+  IADC_ScanTable_t table = IADC_SCANTABLE_DEFAULT;
+
+  // Keep warm, the scans follow each other at the PWM frequency
+  init.warmup = iadcWarmupKeepWarm;
+  init.srcClkPrescale = IADC_calcSrcClkPrescale(IADC0, 20000000, 0);
+
+  // ~1.2 us per conversion, all phases fit in the low-side on-time
+  configs.configs[0].reference = iadcCfgReferenceVddx;
+  configs.configs[0].vRef = (uint32_t)(CURRENT_SENSE_ADC_VREF * 1000.0f);
+  configs.configs[0].osrHighSpeed = iadcCfgOsrHighSpeed2x;
+  configs.configs[0].analogGain = iadcCfgAnalogGain1x;
+  configs.configs[0].adcClkPrescale = IADC_calcAdcClkPrescale(IADC0,
+                                                              10000000,
+                                                              0,
+                                                              iadcCfgModeNormal,
+                                                              init.srcClkPrescale);
+
+  scan.triggerSelect = iadcTriggerSelPrs0PosEdge;
+  scan.triggerAction = iadcTriggerActionOnce;
+  scan.dataValidLevel = iadcFifoCfgDvl1;
+  scan.fifoDmaWakeup = true;
+
+  for (size_t i = 0; i < count; ++i) {
+    PinName pin_name = pinToPinName(pins[i]);
+    GPIO_Port_TypeDef port = getSilabsPortFromArduinoPin(pin_name);
+    uint8_t pin = getSilabsPinFromArduinoPin(pin_name);
+
+    allocate_analog_bus(port, pin);
+    table.entries[i].posInput = IADC_portPinToPosInput(port, pin);
+    table.entries[i].negInput = iadcNegInputGnd;
+    table.entries[i].includeInScan = true;
+
+    _lowside.pins[i] = pins[i];
+  }
+  _lowside.count = count;
+
+  IADC_reset(IADC0);
+  IADC_init(IADC0, &init, &configs);
+  IADC_initScan(IADC0, &scan, &table);
+
+  return &_lowside;
+}
+
+bool currentSenseClass::start_lowside()
+{
+  // LDMA ping-pong between the two scan buffers, interrupt on each
+  LDMA_Descriptor_t first = LDMA_DESCRIPTOR_LINKREL_P2M_WORD(&IADC0->SCANFIFODATA,
+                                                            _lowside.buf[0],
+                                                            _lowside.count,
+                                                            1);
+  LDMA_Descriptor_t second = LDMA_DESCRIPTOR_LINKREL_P2M_WORD(&IADC0->SCANFIFODATA,
+                                                             _lowside.buf[1],
+                                                             _lowside.count,
+                                                             -1);
+  lowside_descriptors[0] = first;
+  lowside_descriptors[1] = second;
+  lowside_descriptors[0].xfer.doneIfs = 1;
+  lowside_descriptors[1].xfer.doneIfs = 1;
+
+  unsigned int channel;
+  DMADRV_Init();
+  if (DMADRV_AllocateChannel(&channel, nullptr) != ECODE_EMDRV_DMADRV_OK) {
+    return false;
+  }
+
+  LDMA_TransferCfg_t transfer = LDMA_TRANSFER_CFG_PERIPHERAL(ldmaPeripheralSignal_IADC0_IADC_SCAN);
+  if (DMADRV_LdmaStartTransfer(channel, &transfer, &lowside_descriptors[0],
+                               lowside_done, this) != ECODE_EMDRV_DMADRV_OK) {
+    return false;
+  }
+
+  // PWM timer -> PRS -> IADC scan trigger
+  int prs = PRS_GetFreeChannel(prsTypeAsync);
+  if (prs < 0) {
+    return false;
+  }
+  PRS_ConnectSignal(prs, prsTypeAsync, CURRENT_SENSE_PRS_SIGNAL);
+  PRS_ConnectConsumer(prs, prsTypeAsync, prsConsumerIADC0_SCANTRIGGER);
+
+  IADC_command(IADC0, iadcCmdStartScan);
+
+  // Without scans the reads stay at 0 V and the offset calibration runs on
+  // zeros, e.g. when the PWM driver does not use the CURRENT_SENSE_PRS_SIGNAL timer
+  uint32_t start = micros();
+  while (_lowside.scans < 2u) {
+    if (micros() - start >= CURRENT_SENSE_START_TIMEOUT_US) {
+      SimpleFOCDebug::println("CS: no low-side scans, check CURRENT_SENSE_PRS_SIGNAL");
+      return false;
+    }
+  }
+
+  return true;
+}
+#else
+void *currentSenseClass::configure_lowside(const int *pins, size_t count)
+{
+  (void)pins;
+  (void)count;
+  return SIMPLEFOC_CURRENT_SENSE_INIT_FAILED;
+}
+
+bool currentSenseClass::start_lowside()
+{
+  return false;
+}
+#endif
+
+float currentSenseClass::read_lowside(int pin)
+{
+  // All phases of a set of reads come from the same scan
+  if (pin == _lowside.pins[0]) {
+    _lowside.read_scan = _lowside.scans;
+  }
+  if (!_lowside.read_scan) {
+    return 0.0f;
+  }
+
+  const uint32_t *buf = _lowside.buf[(_lowside.read_scan - 1u) & 1u];
+  for (size_t i = 0; i < _lowside.count; ++i) {
+    if (_lowside.pins[i] == pin) {
+      return (buf[i] & 0xFFFu) * (CURRENT_SENSE_ADC_VREF / 4095.0f);
+    }
+  }
+  return 0.0f;
+}
+
+uint32_t currentSenseClass::get_scans()
+{
+  return _lowside.scans;
+}
+
+bool currentSenseClass::lowside_done(unsigned int channel, unsigned int sequence, void *user)
+{
+  (void)channel;
+  static_cast<currentSenseClass *>(user)->_lowside.scans = sequence;
+  return true;
+}
+
+void currentSenseClass::begin_sim(BLDCMotor *motor, BLDCDriver *driver, float phase_resistance, float phase_inductance)
+{
+  _sim.motor = motor;
+  _sim.driver = driver;
+  _sim.resistance = phase_resistance;
+  _sim.inductance = phase_inductance;
+  for (auto & current : _sim.current) {
+    current = 0.0f;
+  }
+  _sim.last_us = micros();
+}
+
+PhaseCurrent_s currentSenseClass::read_sim()
+{
+  if (!_sim.motor || !_sim.driver) {
+    return { 0.0f, 0.0f, 0.0f };
+  }
+
+  uint32_t now = micros();
+  float dt = (now - _sim.last_us) * 1e-6f;
+  _sim.last_us = now;
+
+  // Phase voltages against the star point
+  BLDCDriver *driver = _sim.driver;
+  float mid = (driver->dc_a + driver->dc_b + driver->dc_c) / 3.0f;
+  float voltage[_max_pins] = {
+    (driver->dc_a - mid) * driver->voltage_power_supply,
+    (driver->dc_b - mid) * driver->voltage_power_supply,
+    (driver->dc_c - mid) * driver->voltage_power_supply,
+  };
+
+  // Back-EMF on the q axis, as used by SimpleFOC for the KV rating
+  BLDCMotor *motor = _sim.motor;
+  if (_isset(motor->KV_rating)) {
+    float bemf = motor->shaft_velocity / (motor->KV_rating * _SQRT3) / _RPM_TO_RADS;
+    float alpha = -bemf * _sin(motor->electrical_angle);
+    float beta = bemf * _cos(motor->electrical_angle);
+    voltage[0] -= alpha;
+    voltage[1] -= -0.5f * alpha + _SQRT3_2 * beta;
+    voltage[2] -= -0.5f * alpha - _SQRT3_2 * beta;
+  }
+
+  // Exact step response of the RL circuit, stable for any dt
+  float k = 1.0f - expf(-dt * _sim.resistance / _sim.inductance);
+  for (size_t i = 0; i < _max_pins; ++i) {
+    _sim.current[i] += k * (voltage[i] / _sim.resistance - _sim.current[i]);
+  }
+
+  return { _sim.current[0], _sim.current[1], _sim.current[2] };
+}
+
+void currentSenseClass::request_read_time(size_t count)
+{
+  _read_time.requested = count;
+}
+
+void currentSenseClass::time_reads(CurrentSense &current_sense)
+{
+  size_t count = _read_time.requested;
+  if (!count) {
+    return;
+  }
+  _read_time.requested = 0u;
+
+  // Timed as a batch, a low-side read is shorter than the micros() resolution.
+  // The simulated phases integrate the elapsed time, so the extra reads do
+  // not change the currents loopFOC() reads next.
+  uint32_t start = micros();
+  for (size_t i = 0; i < count; ++i) {
+    current_sense.getPhaseCurrents();
+  }
+  uint32_t elapsed = micros() - start;
+
+  _read_time.avg_us = (float)elapsed / count;
+  _read_time.valid = true;
+}
+
+void currentSenseClass::print_read_time(Print &out)
+{
+  out.print("CS read:");
+  if (_read_time.valid) {
+    out.print(_read_time.avg_us);
+    out.print("us");
+  } else {
+    out.print("n/a");
+  }
+  out.print(" scans:");
+  out.println(_lowside.scans);
+}
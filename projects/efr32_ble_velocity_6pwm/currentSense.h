@@ -0,0 +1,122 @@
+/***************************************************************************//**
+ * @file currentSense.h
+ * @brief Phase current sampling header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+#include <SimpleFOC.h>
+
+// Phase current sense selection
+#define CURRENT_SENSE_NONE    0  // Voltage mode torque control
+#define CURRENT_SENSE_LOWSIDE 1  // IADC scan synchronized to the PWM, LDMA double buffer
+#define CURRENT_SENSE_INLINE  2  // analogRead() whenever the loop needs it
+#define CURRENT_SENSE_SIM     3  // RL model of the phases, no ADC
+
+// BOOSTXL-DRV8305 shunts and DRV8305 current sense amplifier default gain
+#ifndef CURRENT_SENSE_SHUNT_RESISTOR
+#define CURRENT_SENSE_SHUNT_RESISTOR 0.007f  // [Ohm]
+#endif
+
+#ifndef CURRENT_SENSE_GAIN
+#define CURRENT_SENSE_GAIN 10.0f  // [V/V]
+#endif
+
+#ifndef CURRENT_SENSE_ADC_VREF
+#define CURRENT_SENSE_ADC_VREF 3.3f  // [V]
+#endif
+
+// PWM timer event which starts the low-side scan. The low-side switches are
+// on around the overflow of the center-aligned PWM timer.
+#ifndef CURRENT_SENSE_PRS_SIGNAL
+#define CURRENT_SENSE_PRS_SIGNAL prsSignalTIMER0_OF
+#endif
+
+// The first scans have to arrive within this time, a few PWM periods
+#ifndef CURRENT_SENSE_START_TIMEOUT_US
+#define CURRENT_SENSE_START_TIMEOUT_US 1000u
+#endif
+
+class currentSenseClass {
+public:
+  currentSenseClass();
+
+  // Low-side sampling, called through the SimpleFOC low-side hooks, which the
+  // sketch defines for CURRENT_SENSE_LOWSIDE only. Every
+  // PWM period the timer starts an IADC scan of the pins through PRS, LDMA
+  // moves the results into a double buffer, so reading is a memory access.
+  void *configure_lowside(const int *pins, size_t count);
+  // Fails when the PWM timer does not start the scans
+  bool start_lowside();
+  float read_lowside(int pin);
+  uint32_t get_scans();
+
+  // Simulated phases. The driver duty cycles give the phase voltages, the
+  // back-EMF comes from the shaft velocity if the motor KV is set.
+  void begin_sim(BLDCMotor *motor, BLDCDriver *driver, float phase_resistance, float phase_inductance);
+  PhaseCurrent_s read_sim();
+
+  // Time of getPhaseCurrents() [us], averaged over count calls. The reads
+  // run in the FOC task, at the next time_reads() call before loopFOC().
+  void request_read_time(size_t count = 16u);
+  void time_reads(CurrentSense &current_sense);
+  void print_read_time(Print &out);
+
+private:
+  static const size_t _max_pins = 3u;
+
+  struct lowside_t {
+    int pins[_max_pins];
+    size_t count;
+    volatile uint32_t scans;    // Completed scans, the latest is in buf[(scans - 1) & 1]
+    uint32_t read_scan;         // Scan used by the current set of reads
+    uint32_t buf[2][_max_pins];
+  };
+  lowside_t _lowside;
+
+  struct sim_t {
+    BLDCMotor *motor;
+    BLDCDriver *driver;
+    float resistance;           // [Ohm]
+    float inductance;           // [H]
+    float current[_max_pins];   // [A]
+    uint32_t last_us;
+  };
+  sim_t _sim;
+
+  struct read_time_t {
+    volatile size_t requested;  // Reads of the next measurement
+    float avg_us;
+    bool valid;
+  };
+  read_time_t _read_time;
+
+  static bool lowside_done(unsigned int channel, unsigned int sequence, void *user);
+};
+
+extern currentSenseClass currentSense;
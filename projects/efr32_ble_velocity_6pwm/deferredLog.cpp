@@ -0,0 +1,132 @@
+/***************************************************************************//**
+ * @file deferredLog.cpp
+ * @brief Non-blocking deferred logger implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "deferredLog.h"
+
+static const char *const log_level_names[] = { "", "E ", "W ", "I ", "D " };
+
+deferredLogClass::deferredLogClass() :
+  _write_pos(0u),
+  _read_pos(0u),
+  _dropped(0u),
+  _dropped_reported(0u)
+{
+  // A record is free for the writer at position pos when its sequence is pos
+  for (uint32_t i = 0; i < LOG_RECORD_COUNT; ++i) {
+    _records[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool deferredLogClass::push_record(
+  uint8_t level,
+  const char *tag,
+  const char *fmt,
+  const uint32_t *args,
+  size_t arg_count
+  )
+{
+  uint32_t pos = _write_pos.load(std::memory_order_relaxed);
+  record_t *record;
+
+  // Reserve a record, multiple writers can race for the same position
+  for (;;) {
+    record = &_records[pos & (LOG_RECORD_COUNT - 1u)];
+    int32_t diff = (int32_t)(record->sequence.load(std::memory_order_acquire) - pos);
+    if (diff == 0) {
+      if (_write_pos.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Full
+      _dropped.fetch_add(1u, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = _write_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  record->timestamp_us = micros();
+  record->tag = tag;
+  record->fmt = fmt;
+  record->level = level;
+  for (size_t i = 0; i < _max_args; ++i) {
+    record->args[i] = i < arg_count ? args[i] : 0u;
+  }
+
+  // Publish the record to the reader
+  record->sequence.store(pos + 1u, std::memory_order_release);
+
+  return true;
+}
+
+size_t deferredLogClass::drain(Print &out, size_t max_records)
+{
+  size_t count = 0;
+
+  uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+  if (dropped != _dropped_reported && max_records) {
+    out.print("log: ");
+    out.print(dropped - _dropped_reported);
+    out.println(" records dropped");
+    _dropped_reported = dropped;
+    count++;
+  }
+
+  for (; count < max_records; ++count) {
+    record_t *record = &_records[_read_pos & (LOG_RECORD_COUNT - 1u)];
+    if (record->sequence.load(std::memory_order_acquire) != _read_pos + 1u) {
+      // Empty, or the writer has not finished the record yet
+      break;
+    }
+
+    const uint32_t *a = record->args;
+    snprintf(_line, sizeof(_line), record->fmt, a[0], a[1], a[2], a[3], a[4], a[5]);
+
+    out.print(record->timestamp_us);
+    out.print(' ');
+    out.print(log_level_names[record->level < LOG_LEVEL_DEBUG ? record->level : LOG_LEVEL_DEBUG]);
+    if (record->tag) {
+      out.print(record->tag);
+    }
+    out.println(_line);
+
+    // Release the record to the writers
+    record->sequence.store(_read_pos + LOG_RECORD_COUNT, std::memory_order_release);
+    _read_pos++;
+  }
+
+  return count;
+}
+
+uint32_t deferredLogClass::get_dropped()
+{
+  return _dropped.load(std::memory_order_relaxed);
+}
+
+deferredLogClass deferredLog;
@@ -0,0 +1,140 @@
+/***************************************************************************//**
+ * @file deferredLog.h
+ * @brief Non-blocking deferred logger header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+#include <atomic>
+#include <type_traits>
+
+// Log levels, records above LOG_LEVEL are compiled out together with their
+// arguments
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_RECORD_COUNT
+#define LOG_RECORD_COUNT 32u  // Must be a power of 2
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(tag, fmt, ...) deferredLog.push(LOG_LEVEL_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(tag, fmt, ...) deferredLog.push(LOG_LEVEL_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(tag, fmt, ...) deferredLog.push(LOG_LEVEL_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(tag, fmt, ...) deferredLog.push(LOG_LEVEL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(tag, fmt, ...) do {} while (0)
+#endif
+
+// Binary deferred logger. The hot path stores the format string pointer and
+// the raw arguments in a lock-free ring, the formatting and printing is done
+// later by drain(). Safe to call from any task or interrupt, never blocks:
+// when the ring is full the record is dropped and counted.
+//
+// The format string and the %s arguments must have static storage duration.
+// Up to 6 integer or pointer arguments are supported, no floating point.
+class deferredLogClass {
+public:
+  deferredLogClass();
+
+  template <typename ... Args>
+  bool push(uint8_t level, const char *tag, const char *fmt, Args ... args)
+  {
+    static_assert(sizeof...(Args) <= _max_args, "Too many log arguments");
+    const uint32_t values[_max_args + 1] = { to_arg(args) ..., 0u };
+    return push_record(level, tag, fmt, values, sizeof...(Args));
+  }
+
+  // Format and print up to max_records records, call from a low priority context
+  size_t drain(Print &out, size_t max_records = 1u);
+
+  uint32_t get_dropped();
+
+private:
+  static const size_t _max_args = 6u;
+  static const size_t _line_size = 96u;
+
+  template <typename T>
+  static typename std::enable_if < std::is_integral < T > ::value || std::is_enum < T > ::value, uint32_t > ::type
+  to_arg(T value)
+  {
+    return (uint32_t)value;
+  }
+
+  template <typename T>
+  static uint32_t to_arg(T *value)
+  {
+    return (uint32_t)(uintptr_t)value;
+  }
+
+  bool push_record(uint8_t level, const char *tag, const char *fmt, const uint32_t *args, size_t arg_count);
+
+  struct record_t {
+    std::atomic < uint32_t > sequence;
+    uint32_t timestamp_us;
+    const char *tag;
+    const char *fmt;
+    uint32_t args[_max_args];
+    uint8_t level;
+  };
+
+  static_assert((LOG_RECORD_COUNT & (LOG_RECORD_COUNT - 1u)) == 0u, "LOG_RECORD_COUNT must be a power of 2");
+
+  record_t _records[LOG_RECORD_COUNT];
+  std::atomic < uint32_t > _write_pos;
+  uint32_t _read_pos;
+
+  std::atomic < uint32_t > _dropped;
+  uint32_t _dropped_reported;
+
+  char _line[_line_size];
+};
+
+extern deferredLogClass deferredLog;
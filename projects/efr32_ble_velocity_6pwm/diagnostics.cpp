@@ -0,0 +1,341 @@
+/***************************************************************************//**
+ * @file diagnostics.cpp
+ * @brief Stack, CPU load and interrupt diagnostics implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "diagnostics.h"
+
+#define GATTDB_NON_ADVERTISED_SERVICE 0x00
+
+// Main stack bounds from the linker script, used by the interrupts
+extern "C" {
+  extern uint32_t __StackLimit __attribute__((weak));
+  extern uint32_t __StackTop __attribute__((weak));
+}
+
+// BLE diagnostics packet, little endian:
+//  uint32 uptime [ms], uint16 ISR stack free [B], uint8 idle [%], uint8 task count,
+//  per task: char[4] name, uint16 stack free [B], uint8 cpu [%], uint8 reserved,
+//  uint8 counter count, per counter: char[4] name, uint32 rate [1/s]
+// The packet is up to 177 B, longer than a notification with the default
+// ATT MTU of 23. Only the 8 byte header is notified, the centrals read the
+// full value (long read).
+static const size_t diag_header_size = 8u;
+static const size_t diag_packet_size = diag_header_size + DIAG_MAX_TASKS * 8u + 1u + DIAG_MAX_COUNTERS * 8u;
+
+static uint8_t diag_packet[diag_packet_size];
+
+diagnosticsClass::diagnosticsClass() :
+  _period_ms(1000u),
+  _last_sample_ms(0u),
+  _task_count(0u),
+  _idle_pct(_unknown),
+  _counter_count(0u),
+  _isr_stack_limit(nullptr),
+  _isr_stack_top(nullptr),
+  _gatt_data_characteristic_handle(0xFFFF)
+{
+#if (configUSE_TRACE_FACILITY == 1)
+  _total_runtime = 0u;
+  _system_task_count = 0u;
+#endif
+}
+
+void diagnosticsClass::begin(uint32_t period_ms)
+{
+  _period_ms = period_ms ? period_ms : 1u;
+  _last_sample_ms = millis();
+
+  if (!&__StackLimit || !&__StackTop) {
+    return;
+  }
+
+  _isr_stack_limit = &__StackLimit;
+  _isr_stack_top = &__StackTop;
+
+  // Paint the unused part of the main stack. The tasks run on their own
+  // stacks, so only the interrupts use the main stack below the current MSP.
+  uint32_t *msp;
+  uint32_t primask;
+  __asm volatile ("mrs %0, msp" : "=r" (msp));
+  __asm volatile ("mrs %0, primask" : "=r" (primask));
+  __asm volatile ("cpsid i" ::: "memory");
+  for (uint32_t *p = _isr_stack_limit; p < msp - 16; ++p) {
+    *p = _stack_pattern;
+  }
+  __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+void diagnosticsClass::run()
+{
+  uint32_t now = millis();
+  if (now - _last_sample_ms < _period_ms) {
+    return;
+  }
+  uint32_t elapsed_ms = now - _last_sample_ms;
+  _last_sample_ms = now;
+
+  sample_tasks();
+
+  for (size_t i = 0; i < _counter_count; ++i) {
+    counter_t &it = _counters[i];
+    uint32_t count = *it.count;
+    it.rate = (uint32_t)((uint64_t)(count - it.last) * 1000u / elapsed_ms);
+    it.last = count;
+  }
+
+  publish();
+}
+
+bool diagnosticsClass::add_task(const char *name, TaskHandle_t task)
+{
+#if (configUSE_TRACE_FACILITY == 1)
+  // All tasks are reported from the system state
+  (void)name;
+  (void)task;
+  return true;
+#else
+  // Called from the BLE task too, while loop() samples the list
+  bool added = false;
+  taskENTER_CRITICAL();
+  if (task && _task_count < DIAG_MAX_TASKS) {
+    _tasks[_task_count] = { task, name, 0u, 0u, _unknown };
+    _task_count = _task_count + 1u;
+    added = true;
+  }
+  taskEXIT_CRITICAL();
+  return added;
+#endif
+}
+
+bool diagnosticsClass::add_counter(const char *name, volatile uint32_t *count)
+{
+  if (!name || !count || _counter_count >= DIAG_MAX_COUNTERS) {
+    return false;
+  }
+
+  counter_t &it = _counters[_counter_count];
+  strncpy(it.name, name, sizeof(it.name) - 1u);
+  it.name[sizeof(it.name) - 1u] = '\0';
+  it.count = count;
+  it.last = *count;
+  it.rate = 0u;
+  _counter_count++;
+
+  return true;
+}
+
+void diagnosticsClass::sample_tasks()
+{
+#if (configUSE_TRACE_FACILITY == 1)
+  // uxTaskGetSystemState() returns no task at all when the array is too small
+  _system_task_count = uxTaskGetNumberOfTasks();
+
+  uint32_t total_runtime = 0u;
+  UBaseType_t count = uxTaskGetSystemState(_task_status, DIAG_MAX_TASKS, &total_runtime);
+  uint32_t total_delta = total_runtime - _total_runtime;
+  _total_runtime = total_runtime;
+
+  task_t tasks[DIAG_MAX_TASKS];
+  _idle_pct = _unknown;
+
+  for (UBaseType_t i = 0; i < count; ++i) {
+    const TaskStatus_t &status = _task_status[i];
+    task_t &it = tasks[i];
+
+    it.handle = status.xHandle;
+    it.name = status.pcTaskName;
+    it.stack_free = status.usStackHighWaterMark * sizeof(StackType_t);
+    it.runtime = status.ulRunTimeCounter;
+    it.cpu_pct = _unknown;
+
+    // Runtime of the task in the previous sample
+    for (size_t j = 0; j < _task_count; ++j) {
+      if (_tasks[j].handle == it.handle && total_delta) {
+        it.cpu_pct = (uint8_t)((uint64_t)(it.runtime - _tasks[j].runtime) * 100u / total_delta);
+        break;
+      }
+    }
+
+    if (!strcmp(it.name, "IDLE")) {
+      _idle_pct = it.cpu_pct;
+    }
+  }
+
+  memcpy(_tasks, tasks, count * sizeof(task_t));
+  _task_count = count;
+#else
+  for (size_t i = 0; i < _task_count; ++i) {
+    _tasks[i].stack_free = uxTaskGetStackHighWaterMark(_tasks[i].handle) * sizeof(StackType_t);
+  }
+#endif
+}
+
+uint32_t diagnosticsClass::isr_stack_free()
+{
+  if (!_isr_stack_limit) {
+    return 0u;
+  }
+
+  const uint32_t *p = _isr_stack_limit;
+  while (p < _isr_stack_top && *p == _stack_pattern) {
+    ++p;
+  }
+  return (uint32_t)(p - _isr_stack_limit) * sizeof(uint32_t);
+}
+
+void diagnosticsClass::print(Print &out)
+{
+  out.print("DIAG uptime:");
+  out.print(millis());
+  out.print(" idle:");
+  if (_idle_pct == _unknown) {
+    out.print("n/a");
+  } else {
+    out.print(_idle_pct);
+    out.print('%');
+  }
+  out.print(" isr_stack_free:");
+  out.println(isr_stack_free());
+
+#if (configUSE_TRACE_FACILITY == 1)
+  if (_system_task_count > DIAG_MAX_TASKS) {
+    out.print("DIAG tasks:");
+    out.print(_system_task_count);
+    out.print(" above DIAG_MAX_TASKS:");
+    out.println(DIAG_MAX_TASKS);
+  }
+#endif
+
+  for (size_t i = 0; i < _task_count; ++i) {
+    const task_t &it = _tasks[i];
+    out.print("RTOS ");
+    out.print(it.name);
+    out.print(" stack_free:");
+    out.print(it.stack_free);
+    out.print(" cpu:");
+    if (it.cpu_pct == _unknown) {
+      out.println("n/a");
+    } else {
+      out.print(it.cpu_pct);
+      out.println('%');
+    }
+  }
+
+  for (size_t i = 0; i < _counter_count; ++i) {
+    const counter_t &it = _counters[i];
+    out.print("ISR ");
+    out.print(it.name);
+    out.print(" rate:");
+    out.print(it.rate);
+    out.print(" total:");
+    out.println(*it.count);
+  }
+}
+
+// BLE:GATT DB
+void diagnosticsClass::init_gattdb(uint16_t session_id)
+{
+  sl_status_t sc;
+  uint16_t service_handle;
+
+  // Add the diagnostics service to the GATT DB
+  // UUID: 79f0b1b2-1cdc-4773-b445-057753db3778
+  sc = sl_bt_gattdb_add_service(
+    session_id,
+    sl_bt_gattdb_primary_service,
+    GATTDB_NON_ADVERTISED_SERVICE,
+    sizeof(diag_service_uuid),
+    diag_service_uuid.data,
+    &service_handle);
+  app_assert_status(sc);
+
+  // Add the 'Diagnostics Data' characteristic to the diagnostics service
+  // UUID: 05c9bed7-73e1-4f25-b8b4-9465381c8568
+  uint8_t diag_data_char_init_value = 0;
+  sc = sl_bt_gattdb_add_uuid128_characteristic(
+    session_id,
+    service_handle,
+    SL_BT_GATTDB_CHARACTERISTIC_READ | SL_BT_GATTDB_CHARACTERISTIC_NOTIFY,
+    0x00,
+    0x00,
+    diag_data_characteristic_uuid,
+    sl_bt_gattdb_variable_length_value,
+    diag_packet_size,                     // max length
+    sizeof(diag_data_char_init_value),    // initial value length
+    &diag_data_char_init_value,           // initial value
+    &_gatt_data_characteristic_handle);
+  app_assert_status(sc);
+
+  // Start the diagnostics service
+  sc = sl_bt_gattdb_start_service(session_id, service_handle);
+  app_assert_status(sc);
+}
+
+void diagnosticsClass::publish()
+{
+  if (_gatt_data_characteristic_handle == 0xFFFF) {
+    return;
+  }
+
+  size_t len = 0;
+  uint32_t uptime = millis();
+  uint16_t isr_stack = (uint16_t)isr_stack_free();
+
+  memcpy(&diag_packet[len], &uptime, sizeof(uptime));
+  len += sizeof(uptime);
+  memcpy(&diag_packet[len], &isr_stack, sizeof(isr_stack));
+  len += sizeof(isr_stack);
+  diag_packet[len++] = _idle_pct;
+  diag_packet[len++] = (uint8_t)_task_count;
+
+  for (size_t i = 0; i < _task_count; ++i) {
+    const task_t &it = _tasks[i];
+    uint16_t stack_free = (uint16_t)it.stack_free;
+    strncpy((char *)&diag_packet[len], it.name, 4u);
+    len += 4u;
+    memcpy(&diag_packet[len], &stack_free, sizeof(stack_free));
+    len += sizeof(stack_free);
+    diag_packet[len++] = it.cpu_pct;
+    diag_packet[len++] = 0u;
+  }
+
+  diag_packet[len++] = (uint8_t)_counter_count;
+
+  for (size_t i = 0; i < _counter_count; ++i) {
+    const counter_t &it = _counters[i];
+    memcpy(&diag_packet[len], it.name, 4u);
+    len += 4u;
+    memcpy(&diag_packet[len], &it.rate, sizeof(it.rate));
+    len += sizeof(it.rate);
+  }
+
+  sl_bt_gatt_server_write_attribute_value(_gatt_data_characteristic_handle, 0u, len, diag_packet);
+  sl_bt_gatt_server_notify_all(_gatt_data_characteristic_handle, diag_header_size, diag_packet);
+}
+
+diagnosticsClass diagnostics;
@@ -0,0 +1,125 @@
+/***************************************************************************//**
+ * @file diagnostics.h
+ * @brief Stack, CPU load and interrupt diagnostics header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#ifndef ARDUINO_SILABS_STACK_BLE_SILABS
+  #error "This library is only compatible with the Silicon Labs BLE stack. Please select 'BLE (Silabs)' in 'Tools > Protocol stack'."
+#endif
+
+#include "Arduino.h"
+extern "C" {
+  #include "sl_bluetooth.h"
+}
+#include "FreeRTOS.h"
+#include "task.h"
+
+#ifndef DIAG_MAX_TASKS
+#define DIAG_MAX_TASKS    12u
+#endif
+#ifndef DIAG_MAX_COUNTERS
+#define DIAG_MAX_COUNTERS 9u
+#endif
+
+// Diagnostics service UUID: 79f0b1b2-1cdc-4773-b445-057753db3778
+const uuid_128 diag_service_uuid = {
+  .data = { 0x78, 0x37, 0xdb, 0x53, 0x77, 0x05, 0x45, 0xb4, 0x73, 0x47, 0xdc, 0x1c, 0xb2, 0xb1, 0xf0, 0x79, }
+};
+
+// Diagnostics data UUID: 05c9bed7-73e1-4f25-b8b4-9465381c8568
+const uuid_128 diag_data_characteristic_uuid = {
+  .data = { 0x68, 0x85, 0x1c, 0x38, 0x65, 0x94, 0xb4, 0xb8, 0x25, 0x4f, 0xe1, 0x73, 0xd7, 0xbe, 0xc9, 0x05, }
+};
+
+class diagnosticsClass {
+public:
+  diagnosticsClass();
+
+  void begin(uint32_t period_ms = 1000u);
+
+  // Sample when the period has elapsed, call from loop()
+  void run();
+
+  // Tasks to watch when the FreeRTOS trace facility is not available.
+  // Otherwise all tasks are reported.
+  bool add_task(const char *name, TaskHandle_t task);
+
+  // Interrupt counters, incremented by the caller in the ISR
+  bool add_counter(const char *name, volatile uint32_t *count);
+
+  void print(Print &out);
+
+  // BLE:GATT DB, call from the onInitGATTDB callback
+  void init_gattdb(uint16_t session_id);
+
+private:
+  void sample_tasks();
+  uint32_t isr_stack_free();
+  void publish();
+
+  static const uint8_t _unknown = 0xFFu;
+
+  uint32_t _period_ms;
+  uint32_t _last_sample_ms;
+
+  struct task_t {
+    TaskHandle_t handle;
+    const char *name;
+    uint32_t stack_free;    // [B]
+    uint32_t runtime;
+    uint8_t cpu_pct;
+  };
+  task_t _tasks[DIAG_MAX_TASKS];
+  volatile size_t _task_count;
+  uint8_t _idle_pct;
+
+#if (configUSE_TRACE_FACILITY == 1)
+  TaskStatus_t _task_status[DIAG_MAX_TASKS];
+  uint32_t _total_runtime;
+  UBaseType_t _system_task_count;
+#endif
+
+  struct counter_t {
+    char name[4];
+    volatile uint32_t *count;
+    uint32_t last;
+    uint32_t rate;          // [1/s]
+  };
+  counter_t _counters[DIAG_MAX_COUNTERS];
+  size_t _counter_count;
+
+  // Main (ISR) stack, painted with _stack_pattern in begin()
+  static const uint32_t _stack_pattern = 0xA5A5A5A5u;
+  uint32_t *_isr_stack_limit;
+  uint32_t *_isr_stack_top;
+
+  uint16_t _gatt_data_characteristic_handle;
+};
+
+extern diagnosticsClass diagnostics;
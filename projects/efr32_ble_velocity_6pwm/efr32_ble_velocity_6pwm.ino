@@ -35,10 +35,43 @@
  */
 #include <SimpleFOC.h>
 #include "sppBLE.h"
+#include "motorAxis.h"
+#include "diagnostics.h"
+#include "motorService.h"
+#include "bleTrace.h"
+#include "currentSense.h"
+#include "controlScheduler.h"
+#include "latencyMonitor.h"
 
 #define HALL_SENSOR_IRQ 1
 #define ENABLE_MONITOR  0
 #define MOTOR_PP        8  // BLDC motor pole pairs
+#define MOTOR_COUNT     1  // Number of motor axes, max. 3
+// Control rates, the FOC rate is locked to the PWM frequency
+#define PWM_FREQUENCY    20000  // [Hz]
+#define FOC_DIVIDER      4      // FOC rate = PWM_FREQUENCY / FOC_DIVIDER
+#define VELOCITY_DIVIDER 5      // Velocity loop rate = FOC rate / VELOCITY_DIVIDER
+#define COMMS_PERIOD_US  5000   // Commands, BLE and telemetry [us]
+// Ramp the motor down if no valid command arrives within this time [ms].
+// 0 disables the command watchdog, set it when the central sends keep-alives.
+#define CMD_TIMEOUT_MS  0
+// Publish the diagnostics on a dedicated BLE characteristic too
+#define ENABLE_BLE_DIAGNOSTICS 0
+// Queue the BLE stack events and handle them from loop()
+#define BLE_DEFERRED_EVENTS 0
+// SPP Rx flow control: RX_FLOW_NONE, RX_FLOW_CREDIT or RX_FLOW_WRITE_RESPONSE
+#define BLE_RX_FLOW_CONTROL sppBLEClass::RX_FLOW_CREDIT
+// BLE traffic record / replay with the 'R' command, uses ~8 kB of RAM.
+// The replayed commands are executed, they drive the motors as recorded.
+#define ENABLE_BLE_TRACE 0
+// Phase current sense of axis 0: CURRENT_SENSE_NONE (voltage mode torque
+// control), CURRENT_SENSE_LOWSIDE, CURRENT_SENSE_INLINE or CURRENT_SENSE_SIM.
+// With a current sense the velocity loop drives a FOC current loop.
+#define CURRENT_SENSE   CURRENT_SENSE_NONE
+#define CURRENT_LIMIT   2.0f  // [A], velocity loop output limit
+// Phase model of CURRENT_SENSE_SIM
+#define SIM_PHASE_RESISTANCE 0.4f     // [Ohm]
+#define SIM_PHASE_INDUCTANCE 0.0006f  // [H]
 // I/O configuration
 #if defined(ARDUINO_BOARD_SILABS_THINGPLUSMATTER)
 #pragma message ( "ARDUINO_BOARD_SILABS_THINGPLUSMATTER" )
@@ -52,6 +85,9 @@
 #define HALL_A     D3
 #define HALL_B     D0
 #define HALL_C     D11
+#define ISEN_A     A5
+#define ISEN_B     A4
+#define ISEN_C     A3
 #elif defined(ARDUINO_BOARD_NANO_MATTER)
 #pragma message ( "ARDUINO_BOARD_NANO_MATTER" )
 #define PWM_1H     D6
@@ -64,44 +100,457 @@
 #define HALL_A     D5
 #define HALL_B     D4
 #define HALL_C     D13
+#define ISEN_A     A0
+#define ISEN_B     A1
+#define ISEN_C     A2
 #else
 #error "Board is not supported"
 #endif
 
+// Additional axes have no default wiring, define AXISn_* for axis n in the
+// same order as the motorAxis constructor parameters:
+// #define AXIS1_PINS PWM_1H, PWM_1L, PWM_2H, PWM_2L, PWM_3H, PWM_3L, PWM_EN, HALL_A, HALL_B, HALL_C
+#if MOTOR_COUNT < 1 || MOTOR_COUNT > 3
+#error "MOTOR_COUNT must be 1, 2 or 3"
+#endif
+#if MOTOR_COUNT > 1 && !defined(AXIS1_PINS)
+#error "AXIS1_PINS must be defined when MOTOR_COUNT > 1"
+#endif
+#if MOTOR_COUNT > 2 && !defined(AXIS2_PINS)
+#error "AXIS2_PINS must be defined when MOTOR_COUNT > 2"
+#endif
+
 static bool allow_run = false;
 
-// BLDC motor instance
-BLDCMotor *motor;
+// Motor registry, axis 0 is commanded by 'M', axis 1 by 'N', axis 2 by 'O'
+motorAxis axes[MOTOR_COUNT] = {
+  { 'M', PWM_1H, PWM_1L, PWM_2H, PWM_2L, PWM_3H, PWM_3L, PWM_EN, HALL_A, HALL_B, HALL_C, MOTOR_PP },
+#if MOTOR_COUNT > 1
+  { 'N', AXIS1_PINS, MOTOR_PP },
+#endif
+#if MOTOR_COUNT > 2
+  { 'O', AXIS2_PINS, MOTOR_PP },
+#endif
+};
+
+// BLE motor control service of each axis
+motorService motor_services[MOTOR_COUNT];
+
+// Current sense of axis 0
+#if CURRENT_SENSE == CURRENT_SENSE_LOWSIDE
+LowsideCurrentSense current_sense(CURRENT_SENSE_SHUNT_RESISTOR, CURRENT_SENSE_GAIN, ISEN_A, ISEN_B, ISEN_C);
+
+// SimpleFOC low-side hooks, replace the weak generic implementations. Only
+// defined for low-side sensing, the other builds keep the SimpleFOC defaults.
+void* _configureADCLowSide(const void *driver_params, const int pinA, const int pinB, const int pinC)
+{
+  (void)driver_params;
+  const int pins[] = { pinA, pinB, pinC };
+  return currentSense.configure_lowside(pins, _isset(pinC) ? 3u : 2u);
+}
+
+void* _driverSyncLowSide(void *driver_params, void *cs_params)
+{
+  (void)driver_params;
+  if (!currentSense.start_lowside()) {
+    return SIMPLEFOC_CURRENT_SENSE_INIT_FAILED;
+  }
+  return cs_params;
+}
+
+float _readADCVoltageLowSide(const int pinA, const void *cs_params)
+{
+  (void)cs_params;
+  return currentSense.read_lowside(pinA);
+}
+#elif CURRENT_SENSE == CURRENT_SENSE_INLINE
+InlineCurrentSense current_sense(CURRENT_SENSE_SHUNT_RESISTOR, CURRENT_SENSE_GAIN, ISEN_A, ISEN_B, ISEN_C);
+#elif CURRENT_SENSE == CURRENT_SENSE_SIM
+PhaseCurrent_s readSimCurrents()
+{
+  return currentSense.read_sim();
+}
 
-// BLDC driver instance
-BLDCDriver6PWM *driver;
+GenericCurrentSense current_sense(readSimCurrents);
+#endif
 
 // Commander instance
-Commander *command;
+Commander command(Serial);
 
-// Hall sensor instance
-HallSensor *sensor;
+#if BLE_DEFERRED_EVENTS
+// Deferred BLE events, handled by the comms task
+static sppBLEClass::event_entry_t ble_event_queue[SPP_BLE_EVENT_QUEUE_SIZE];
+#endif
+
+#if ENABLE_BLE_TRACE
+bleTraceRecorder ble_recorder;
+bleTraceReplayer ble_replayer;
+Commander replay_command;
+BLDCMotor replay_motor(MOTOR_PP);  // Never initialised nor linked to a driver
+static uint32_t replay_skipped = 0;
+#endif
+
+// Control scheduler, FOC and velocity tasks per axis plus the comms task
+#define FOC_PERIOD_US       (1000000UL * FOC_DIVIDER / PWM_FREQUENCY)
+#define VELOCITY_PERIOD_US  (FOC_PERIOD_US * VELOCITY_DIVIDER)
+controlScheduler scheduler;
+static char task_names[MOTOR_COUNT][2][5];
 
 // Interrupt routine initialisation
+template <size_t axis>
 void doA()
 {
-  sensor->handleA();
+  axes[axis].hall_isr_count[0]++;
+  axes[axis].sensor.handleA();
 }
+template <size_t axis>
 void doB()
 {
-  sensor->handleB();
+  axes[axis].hall_isr_count[1]++;
+  axes[axis].sensor.handleB();
 }
+template <size_t axis>
 void doC()
 {
-  sensor->handleC();
+  axes[axis].hall_isr_count[2]++;
+  axes[axis].sensor.handleC();
+}
+
+// True when value is a complete number, e.g. the target of "M50" or the gain of "MVP0.5"
+static bool isCommandValue(const char* value)
+{
+  char* end;
+  strtof(value, &end);
+  if (end == value) {
+    return false;
+  }
+  while (*end == ' ' || *end == '\r') {
+    end++;
+  }
+  return *end == '\0';
 }
 
+// Receive time of the command being dispatched, BLE writes are stamped by sppBLE
+static uint32_t commandRxTime(uint32_t dispatch_us)
+{
+  return (command.com_port == &sppBLE) ? sppBLE.get_rx_timestamp() : dispatch_us;
+}
+
+template <size_t axis>
 void doMotor(char* cmd)
 {
-  if (!command) {
+  uint32_t dispatch_us = micros();
+
+  // A target, or a setting with a value. Queries and malformed commands do
+  // not feed the command watchdog.
+  bool target = isCommandValue(cmd);
+  size_t letters = 0;
+  while (letters < 2 && isAlpha(cmd[letters])) {
+    letters++;
+  }
+  bool control = target || (letters && isCommandValue(&cmd[letters]));
+
+  // The velocity PID and the limits are staged, the rest applies directly
+  if (!axes[axis].params.stage_command(command, cmd)) {
+    command.motor(&axes[axis].motor, cmd);
+
+    // Target commands start a latency probe
+    if (target) {
+      latency.command_dispatched(axis, command.com_port == &sppBLE, commandRxTime(dispatch_us), dispatch_us,
+                                 axes[axis].motor.target, axes[axis].motor.shaft_velocity);
+    }
+  }
+  if (control) {
+    axes[axis].supervisor.feed();
+  }
+}
+
+// Fault changes are only flagged on the velocity task, the comms task prints them
+static volatile bool fault_pending[MOTOR_COUNT];
+
+template <size_t axis>
+void onFault(uint16_t faults)
+{
+  // The comms task prints the faults latched by then
+  (void)faults;
+  fault_pending[axis] = true;
+}
+
+static void reportFaults()
+{
+  for (size_t i = 0; i < MOTOR_COUNT; ++i) {
+    if (!fault_pending[i]) {
+      continue;
+    }
+    fault_pending[i] = false;
+
+    uint16_t faults = axes[i].supervisor.get_faults();
+    Serial.print("FAULT ");
+    Serial.print(axes[i].id);
+    Serial.print(":0x");
+    Serial.println(faults, HEX);
+    sppBLE.print("FAULT ");
+    sppBLE.print(axes[i].id);
+    sppBLE.print(":0x");
+    sppBLE.println(faults, HEX);
+  }
+}
+
+struct axis_callbacks_t {
+  void (*doA)();
+  void (*doB)();
+  void (*doC)();
+  void (*doMotor)(char*);
+  void (*onFault)(uint16_t);
+};
+
+#define AXIS_CALLBACKS(axis) { doA<axis>, doB<axis>, doC<axis>, doMotor<axis>, onFault<axis> }
+
+static const axis_callbacks_t axis_callbacks[MOTOR_COUNT] = {
+  AXIS_CALLBACKS(0),
+#if MOTOR_COUNT > 1
+  AXIS_CALLBACKS(1),
+#endif
+#if MOTOR_COUNT > 2
+  AXIS_CALLBACKS(2),
+#endif
+};
+
+// P: parameter sets, PC: commit, PR: rollback, PA0/PA1: auto-commit off/on
+void doParams(char* cmd)
+{
+  if (!command.com_port) {
     return;
   }
-  command->motor(motor, cmd);
+
+  // Applied by the velocity tasks, at the next loop boundary of each axis
+  for (auto & axis : axes) {
+    switch (cmd[0]) {
+      case 'C':
+        axis.params.commit();
+        break;
+      case 'R':
+        axis.params.rollback();
+        break;
+      case 'A':
+        axis.params.set_auto_commit(cmd[1] != '0');
+        break;
+      default:
+        break;
+    }
+
+    command.com_port->print(axis.id);
+    command.com_port->print(" params v");
+    command.com_port->print(axis.params.get_version());
+    command.com_port->print(" auto:");
+    command.com_port->print(axis.params.get_auto_commit() ? 1 : 0);
+    command.com_port->print(" pending:");
+    command.com_port->println(axis.params.is_pending() ? 1 : 0);
+    axis.params.print(*command.com_port);
+  }
+}
+
+void doFault(char* cmd)
+{
+  if (!command.com_port) {
+    return;
+  }
+  for (auto & axis : axes) {
+    if (cmd[0] == 'C') {
+      axis.supervisor.clear_faults();
+    }
+    command.com_port->print("FAULT ");
+    command.com_port->print(axis.id);
+    command.com_port->print(":0x");
+    command.com_port->println(axis.supervisor.get_faults(), HEX);
+  }
+}
+
+void doLoopTime(char* cmd)
+{
+  if (!command.com_port) {
+    return;
+  }
+  for (auto & axis : axes) {
+    if (cmd[0] == 'R') {
+      axis.reset_loop_time();
+    }
+    axis.print_loop_time(*command.com_port);
+  }
+  if (cmd[0] == 'R') {
+    scheduler.reset_stats();
+  }
+  scheduler.print(*command.com_port);
+#if CURRENT_SENSE != CURRENT_SENSE_NONE
+  // Measured by the FOC task, printed by the next T
+  currentSense.print_read_time(*command.com_port);
+  currentSense.request_read_time();
+#endif
+}
+
+// Y<t1>: time sync request, YF<t4>: time sync finish, central time [us]
+void doTimeSync(char* cmd)
+{
+  if (!command.com_port) {
+    return;
+  }
+  if (cmd[0] == 'F') {
+    latency.sync_finish(strtoul(&cmd[1], nullptr, 10));
+  } else {
+    latency.sync_request(strtoul(cmd, nullptr, 10), commandRxTime(micros()), *command.com_port);
+  }
+}
+
+// @<t>: central send time [us] of the next command, after the time sync
+void doTimestamp(char* cmd)
+{
+  latency.set_central_timestamp(strtoul(cmd, nullptr, 10));
+}
+
+// L: command latency, LR: reset
+void doLatency(char* cmd)
+{
+  if (!command.com_port) {
+    return;
+  }
+  if (cmd[0] == 'R') {
+    latency.reset();
+  }
+  latency.print(*command.com_port);
+}
+
+void doDiagnostics(char* cmd)
+{
+  if (!command.com_port) {
+    return;
+  }
+  diagnostics.print(*command.com_port);
+}
+
+void doEventStats(char* cmd)
+{
+  if (!command.com_port) {
+    return;
+  }
+  if (cmd[0] == 'R') {
+    sppBLE.reset_event_stats();
+    sppBLE.reset_rx_stats();
+  }
+  sppBLE.print_event_stats(*command.com_port);
+  sppBLE.print_rx_stats(*command.com_port);
+}
+
+#if ENABLE_BLE_TRACE
+// R: trace status, RS: record, RP: stop, RC: clear, RD: dump, RL<hex>: load,
+// RR: replay with the recorded timing, RX: replay at max. speed
+void doTrace(char* cmd)
+{
+  if (!command.com_port) {
+    return;
+  }
+
+  switch (cmd[0]) {
+    case 'S':
+      ble_replayer.stop();
+      ble_recorder.start(sppBLE.get_rx_flow_control(), sppBLE.get_data_characteristic_handle());
+      break;
+
+    case 'P':
+      ble_recorder.stop();
+      ble_replayer.stop();
+      break;
+
+    case 'C':
+      ble_recorder.clear();
+      break;
+
+    case 'D':
+      ble_recorder.stop();
+      ble_recorder.dump(*command.com_port);
+      return;
+
+    case 'L':
+      if (!ble_recorder.load_hex(cmd + 1)) {
+        command.com_port->println("ERR");
+      }
+      return;
+
+    case 'R':
+    case 'X':
+      ble_recorder.stop();
+      replay_skipped = 0;
+      if (!ble_replayer.start(ble_recorder.get_data(), ble_recorder.get_size(),
+                              cmd[0] == 'R' ? bleTraceReplayer::REPLAY_RECORDED
+                                            : bleTraceReplayer::REPLAY_MAX)) {
+        command.com_port->println("ERR");
+      }
+      return;
+
+    default:
+      break;
+  }
+
+  command.com_port->print("trace ");
+  command.com_port->print(ble_recorder.get_size());
+  command.com_port->print('/');
+  command.com_port->print(BLE_TRACE_BUFFER_SIZE);
+  command.com_port->print("B events:");
+  command.com_port->print(ble_recorder.get_events());
+  command.com_port->print(" dropped:");
+  command.com_port->print(ble_recorder.get_dropped());
+  command.com_port->println(ble_recorder.is_recording() ? " recording" : "");
+  command.com_port->print("replay skipped:");
+  command.com_port->println(replay_skipped);
+  ble_replayer.print_replay_stats(*command.com_port);
+}
+
+// The replayed motor commands are parsed like the live traffic, but set an
+// unlinked motor, so a replay never drives the real motors. The enable
+// command calls the driver, which replay_motor does not have, so it is only
+// counted.
+void doReplayMotor(char* cmd)
+{
+  if (cmd[0] == 'E') {
+    replay_skipped++;
+    return;
+  }
+  replay_command.motor(&replay_motor, cmd);
+}
+
+// The replayed SPP data runs through a separate Commander with only the motor ids
+void onReplayData(Stream &stream)
+{
+  replay_command.run(stream);
+}
+#endif
+
+void onBLEEvent(sl_bt_msg_t *evt)
+{
+#if ENABLE_BLE_TRACE
+  ble_recorder.record(evt);
+#endif
+
+  for (auto & service : motor_services) {
+    service.handle_ble_event(evt);
+  }
+
+  // The BLE events are handled in the context of the BLE stack task,
+  // unless they are deferred to loop()
+  static bool ble_task_added = false;
+  if (!ble_task_added && !sppBLE.get_deferred_events()) {
+    ble_task_added = diagnostics.add_task("ble", xTaskGetCurrentTaskHandle());
+  }
+}
+
+void onInitGATTDB(uint16_t session_id)
+{
+  for (auto & service : motor_services) {
+    service.init_gattdb(session_id);
+  }
+
+#if ENABLE_BLE_DIAGNOSTICS
+  diagnostics.init_gattdb(session_id);
+#endif
 }
 
 bool sendReady(size_t index, const uint8_t *buffer, size_t size)
@@ -115,24 +564,18 @@ bool sendReady(size_t index, const uint8_t *buffer, size_t size)
   return false;
 }
 
-void setup()
+bool setupAxis(motorAxis &axis, const axis_callbacks_t &callbacks, CurrentSense *current_sense)
 {
-  Serial.begin(115200);
-
-  SimpleFOCDebug::enable(&Serial);
-
-  // Driver
-  driver = new BLDCDriver6PWM(PWM_1H, PWM_1L, PWM_2H, PWM_2L, PWM_3H, PWM_3L, PWM_EN);
-  if (!driver) {
-    return;
-  }
+  BLDCDriver6PWM *driver = &axis.driver;
+  HallSensor *sensor = &axis.sensor;
+  BLDCMotor *motor = &axis.motor;
 
   // Power supply voltage [V]
   driver->voltage_power_supply = 24;
   // Max DC voltage allowed - default voltage_power_supply
   driver->voltage_limit = 12;
   // PWM frequency to be used [Hz]
-  driver->pwm_frequency = 20000;
+  driver->pwm_frequency = PWM_FREQUENCY;
   // Dead zone percentage of the duty cycle - default 0.02 - 2%
   // Can set value to 0 because the TI driver (DRV8305) will provide the
   // required dead-time.
@@ -140,21 +583,22 @@ void setup()
 
   // Init driver
   if (!driver->init()) {
-    return;
+    return false;
   }
 
   driver->enable();
 
   // Setup Hall Sensor
-  sensor = new HallSensor(HALL_A, HALL_B, HALL_C, MOTOR_PP);
-  if (!sensor) {
-    return;
-  }
-
   sensor->init();
 
+  char isr_name[] = { axis.id, 'A', '\0' };
+  for (size_t i = 0; i < 3; ++i) {
+    isr_name[1] = 'A' + i;
+    diagnostics.add_counter(isr_name, &axis.hall_isr_count[i]);
+  }
+
 #if HALL_SENSOR_IRQ
-  sensor->enableInterrupts(doA, doB, doC);
+  sensor->enableInterrupts(callbacks.doA, callbacks.doB, callbacks.doC);
 #else
   // Note: There is a bug when initializing HallSensor in heap, attribute
   // `use_interrupt` gets value not `false` even `enableInterrupts` has not been
@@ -163,12 +607,6 @@ void setup()
   sensor->use_interrupt = false;
 #endif
 
-  // Setup BLDC Motor
-  motor = new BLDCMotor(MOTOR_PP);
-  if (!motor) {
-    return;
-  }
-
   // Link the motor and the driver
   motor->linkDriver(driver);
 
@@ -192,6 +630,19 @@ void setup()
   // velocity low pass filtering time constant
   motor->LPF_velocity.Tf = 0.01f;
 
+  // Torque loop under the velocity loop. With a current sense the velocity
+  // PI output is a q axis current [A] instead of a voltage.
+  if (current_sense) {
+    motor->torque_controller = TorqueControlType::foc_current;
+    motor->current_limit = CURRENT_LIMIT;
+    motor->PID_current_q.P = 3;
+    motor->PID_current_q.I = 300;
+    motor->PID_current_d.P = 3;
+    motor->PID_current_d.I = 300;
+    motor->LPF_current_q.Tf = 0.005f;
+    motor->LPF_current_d.Tf = 0.005f;
+  }
+
 #if ENABLE_MONITOR
   motor->useMonitoring(Serial);
   motor->monitor_variables = _MON_TARGET | _MON_CURR_Q | _MON_CURR_D | _MON_VEL;
@@ -200,36 +651,196 @@ void setup()
   // Initialize motor
   if (!motor->init()) {
     Serial.println("Motor init failed!");
-    return;
+    return false;
   }
 
-  // Commander
-  command = new Commander(Serial);
-  if (!command) {
-    return;
+  // Current sense, the driver PWM has to run for the low-side sampling
+  if (current_sense) {
+    current_sense->linkDriver(driver);
+    if (!current_sense->init()) {
+      Serial.println("Current sense init failed!");
+      return false;
+    }
+    motor->linkCurrentSense(current_sense);
   }
 
-  // add target command M
-  command->add('M', doMotor, "motor");
+  // add target command
+  command.add(axis.id, callbacks.doMotor, "motor");
 
   // align sensor and start FOC
   if (!motor->initFOC()) {
     Serial.println("FOC init failed!");
-    return;
+    return false;
+  }
+
+  // Runtime parameters, from the configuration above
+  axis.params.begin(motor);
+
+  // Fault supervisor
+  axis.supervisor.begin(motor, sensor);
+  axis.supervisor.set_cmd_timeout(CMD_TIMEOUT_MS);
+  axis.supervisor.onFault(callbacks.onFault);
+
+  axis.ready = true;
+
+  return true;
+}
+
+// Scheduled tasks
+// main FOC algorithm function, at a fixed rate below the PWM frequency
+void focTask(void *arg)
+{
+  motorAxis *axis = static_cast<motorAxis *>(arg);
+#if CURRENT_SENSE != CURRENT_SENSE_NONE
+  // Phase current read timing, on request of the T command
+  if (axis == &axes[0]) {
+    currentSense.time_reads(current_sense);
+  }
+#endif
+  axis->loop_foc();
+}
+
+// Motion control and fault detection, the supervisor disables the driver on fault
+void velocityTask(void *arg)
+{
+  motorAxis *axis = static_cast<motorAxis *>(arg);
+  size_t index = axis - axes;
+  // Committed parameters take effect before the velocity loop runs
+  axis->params.apply();
+  latency.before_move(index);
+  axis->move();
+  latency.after_move(index, axis->motor.shaft_velocity);
+  axis->supervisor.run();
+}
+
+void commsTask(void *arg)
+{
+  (void)arg;
+
+#if ENABLE_MONITOR
+  // Function intended to be used with serial plotter to monitor motor variables
+  // significantly slowing the execution down!!!!
+  for (auto & axis : axes) {
+    axis.motor.monitor();
+  }
+#endif
+
+  // Deferred BLE events, bounded work per pass
+  sppBLE.process_events();
+
+#if ENABLE_BLE_TRACE
+  ble_replayer.run();
+#endif
+
+  // BLE motor control notifications
+  for (auto & service : motor_services) {
+    service.run();
+  }
+
+  // Stack and CPU load sampling
+  diagnostics.run();
+
+  // Fault reports of the velocity tasks
+  reportFaults();
+
+  // Print one deferred log record per pass
+  deferredLog.drain(Serial);
+
+  // user communication
+  command.run();
+
+  command.run(sppBLE);
+}
+
+void setupScheduler()
+{
+  // FOC first, it runs whenever it is due. The velocity tasks of the axes
+  // are staggered over the FOC periods, the comms task runs in between.
+  for (size_t i = 0; i < MOTOR_COUNT; ++i) {
+    snprintf(task_names[i][0], sizeof(task_names[i][0]), "%cfoc", axes[i].id);
+    scheduler.add_task(task_names[i][0], FOC_PERIOD_US, 0u, focTask, &axes[i]);
+  }
+  for (size_t i = 0; i < MOTOR_COUNT; ++i) {
+    snprintf(task_names[i][1], sizeof(task_names[i][1]), "%cvel", axes[i].id);
+    scheduler.add_task(task_names[i][1], VELOCITY_PERIOD_US,
+                       (i % VELOCITY_DIVIDER) * FOC_PERIOD_US, velocityTask, &axes[i]);
   }
+  scheduler.add_task("comms", COMMS_PERIOD_US, FOC_PERIOD_US / 2u, commsTask);
+  scheduler.begin();
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  SimpleFOCDebug::enable(&Serial);
+
+#if CURRENT_SENSE == CURRENT_SENSE_SIM
+  currentSense.begin_sim(&axes[0].motor, &axes[0].driver, SIM_PHASE_RESISTANCE, SIM_PHASE_INDUCTANCE);
+#endif
+
+  for (size_t i = 0; i < MOTOR_COUNT; ++i) {
+#if CURRENT_SENSE != CURRENT_SENSE_NONE
+    CurrentSense *axis_current_sense = (i == 0) ? &current_sense : nullptr;
+#else
+    CurrentSense *axis_current_sense = nullptr;
+#endif
+    if (!setupAxis(axes[i], axis_callbacks[i], axis_current_sense)) {
+      return;
+    }
+    motor_services[i].begin(&axes[i]);
+  }
+
+  // add fault query / clear command F
+  command.add('F', doFault, "fault");
+
+  // add loop time query / reset command T
+  command.add('T', doLoopTime, "loop time");
+
+  // add diagnostics query command D
+  command.add('D', doDiagnostics, "diagnostics");
+
+  // add BLE event statistics query / reset command E
+  command.add('E', doEventStats, "ble events");
+  command.add('P', doParams, "params");
+
+  // add time sync Y, command timestamp @ and latency query / reset L
+  command.add('Y', doTimeSync, "time sync");
+  command.add('@', doTimestamp, "timestamp");
+  command.add('L', doLatency, "latency");
+#if ENABLE_BLE_TRACE
+  command.add('R', doTrace, "ble trace");
+  for (auto & axis : axes) {
+    replay_command.add(axis.id, doReplayMotor, "motor");
+  }
+  ble_replayer.onReplayData(onReplayData);
+#endif
 
   Serial.println("Motor ready!");
   Serial.println("Set target velocity [rad/s]");
 
   // BLE SPP
   sppBLE.onCheckSendCondition(sendReady);
+  sppBLE.onBLEEvent(onBLEEvent);
+  sppBLE.onInitGATTDB(onInitGATTDB);
+#if BLE_DEFERRED_EVENTS
+  sppBLE.set_deferred_events(ble_event_queue);
+#endif
+  sppBLE.set_rx_flow_control(BLE_RX_FLOW_CONTROL);
   // sppBLE.enable_log(true);
   sppBLE.begin("motor");
   Serial.println("BLE ready!");
 
+  // Diagnostics, setup() and loop() run in the same task
+  diagnostics.add_task("loop", xTaskGetCurrentTaskHandle());
+  diagnostics.begin();
+
   allow_run = true;
 
   _delay(1000);
+
+  // Last, the time grid starts now
+  setupScheduler();
 }
 
 void loop()
@@ -238,21 +849,5 @@ void loop()
     return;
   }
 
-  // main FOC algorithm function
-  // the faster you run this function the better
-  motor->loopFOC();
-
-  // Motion control function
-  motor->move();
-
-#if ENABLE_MONITOR
-  // Function intended to be used with serial plotter to monitor motor variables
-  // significantly slowing the execution down!!!!
-  motor->monitor();
-#endif
-
-  // user communication
-  command->run();
-
-  command->run(sppBLE);
+  scheduler.run();
 }
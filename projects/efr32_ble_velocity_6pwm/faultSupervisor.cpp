@@ -0,0 +1,233 @@
+/***************************************************************************//**
+ * @file faultSupervisor.cpp
+ * @brief Motor fault detection and fast-trip protection implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "faultSupervisor.h"
+
+faultSupervisor::faultSupervisor() :
+  _motor(nullptr),
+  _sensor(nullptr),
+  _faults(FAULT_NONE),
+  _reported(FAULT_NONE),
+  user_onfault_callback(nullptr)
+{
+}
+
+void faultSupervisor::begin(BLDCMotor *motor, HallSensor *sensor)
+{
+  _motor = motor;
+  _sensor = sensor;
+
+  uint32_t now = millis();
+  _stall.slow_since_ms = now;
+  _stall.last_edge_ms = now;
+  _stall.last_edge_count = sensor ? sensor->total_interrupts : 0;
+  _watchdog.last_cmd_ms = now;
+}
+
+void faultSupervisor::run()
+{
+  if (!_motor || !_sensor) {
+    return;
+  }
+
+  uint32_t now = millis();
+
+  if (!is_tripped() && _motor->enabled) {
+    float velocity = fabsf(_motor->shaft_velocity);
+    bool commanded = fabsf(_motor->target) >= _stall.min_target;
+
+    // Invalid Hall state: both 000 and 111 are impossible with 120 deg sensors
+    int8_t hall_state = _sensor->hall_state;
+    if (hall_state == 0 || hall_state == 7) {
+      if (_hall_state_count < _hall_state_limit) {
+        _hall_state_count++;
+      }
+      if (_hall_state_count >= _hall_state_limit) {
+        latch(FAULT_HALL_STATE);
+      }
+    } else {
+      _hall_state_count = 0u;
+    }
+
+    // Missing Hall edges
+    long edge_count = _sensor->total_interrupts;
+    if (edge_count != _stall.last_edge_count || !commanded) {
+      _stall.last_edge_count = edge_count;
+      _stall.last_edge_ms = now;
+    } else if (now - _stall.last_edge_ms >= _stall.edge_timeout_ms) {
+      latch(FAULT_HALL_EDGE);
+    }
+
+    // Stall
+    if (!commanded || velocity >= _stall.min_velocity) {
+      _stall.slow_since_ms = now;
+    } else if (now - _stall.slow_since_ms >= _stall.time_ms) {
+      latch(FAULT_STALL);
+    }
+
+    // Over-speed, trips immediately
+    if (velocity > _motor->velocity_limit * _overspeed_ratio) {
+      latch(FAULT_OVERSPEED);
+    }
+
+    if (_faults & FAULT_TRIP_MASK) {
+      trip();
+    }
+  }
+
+  // Command watchdog
+  if (_watchdog.timeout_ms && !_watchdog.ramping
+      && now - _watchdog.last_cmd_ms >= _watchdog.timeout_ms) {
+    _watchdog.ramping = true;
+    _watchdog.last_ramp_us = micros();
+    latch(FAULT_CMD_TIMEOUT);
+  }
+  if (_watchdog.ramping) {
+    ramp_down(micros());
+  }
+
+  if (_faults != _reported) {
+    _reported = _faults;
+    if (user_onfault_callback) {
+      user_onfault_callback(_reported);
+    }
+  }
+}
+
+void faultSupervisor::feed()
+{
+  _watchdog.last_cmd_ms = millis();
+  _watchdog.ramping = false;
+}
+
+uint16_t faultSupervisor::get_faults()
+{
+  return _faults;
+}
+
+bool faultSupervisor::is_tripped()
+{
+  return (_faults & FAULT_TRIP_MASK) != 0u;
+}
+
+void faultSupervisor::clear_faults()
+{
+  bool tripped = is_tripped();
+
+  _faults = FAULT_NONE;
+  _hall_state_count = 0u;
+
+  uint32_t now = millis();
+  _stall.slow_since_ms = now;
+  _stall.last_edge_ms = now;
+  if (_sensor) {
+    _stall.last_edge_count = _sensor->total_interrupts;
+  }
+
+  if (tripped && _motor) {
+    _motor->target = 0.0f;
+    _motor->enable();
+  }
+}
+
+void faultSupervisor::onFault(void (*user_onfault_callback)(uint16_t))
+{
+  if (!user_onfault_callback) {
+    return;
+  }
+  this->user_onfault_callback = user_onfault_callback;
+}
+
+void faultSupervisor::set_stall_detection(float min_target, float min_velocity, uint32_t time_ms)
+{
+  _stall.min_target = min_target;
+  _stall.min_velocity = min_velocity;
+  _stall.time_ms = time_ms;
+}
+
+void faultSupervisor::set_hall_edge_timeout(uint32_t time_ms)
+{
+  _stall.edge_timeout_ms = time_ms;
+}
+
+void faultSupervisor::set_hall_state_limit(uint8_t count)
+{
+  _hall_state_limit = count ? count : 1u;
+}
+
+void faultSupervisor::set_overspeed_ratio(float ratio)
+{
+  _overspeed_ratio = ratio;
+}
+
+void faultSupervisor::set_cmd_timeout(uint32_t time_ms)
+{
+  _watchdog.timeout_ms = time_ms;
+  _watchdog.last_cmd_ms = millis();
+}
+
+uint32_t faultSupervisor::get_cmd_timeout()
+{
+  return _watchdog.timeout_ms;
+}
+
+void faultSupervisor::set_ramp_down_rate(float rate)
+{
+  _watchdog.ramp_rate = fabsf(rate);
+}
+
+void faultSupervisor::latch(uint16_t fault)
+{
+  _faults |= fault;
+}
+
+void faultSupervisor::trip()
+{
+  if (!_motor->enabled) {
+    return;
+  }
+  // BLDCMotor::disable() zeroes the phase voltages and calls driver->disable()
+  _motor->target = 0.0f;
+  _motor->disable();
+}
+
+void faultSupervisor::ramp_down(uint32_t now_us)
+{
+  float dt = (now_us - _watchdog.last_ramp_us) * 1e-6f;
+  _watchdog.last_ramp_us = now_us;
+
+  float step = _watchdog.ramp_rate * dt;
+  float target = _motor->target;
+
+  if (fabsf(target) <= step) {
+    _motor->target = 0.0f;
+  } else {
+    _motor->target = target > 0.0f ? target - step : target + step;
+  }
+}
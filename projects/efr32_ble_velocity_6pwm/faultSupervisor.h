@@ -0,0 +1,117 @@
+/***************************************************************************//**
+ * @file faultSupervisor.h
+ * @brief Motor fault detection and fast-trip protection header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+#include <SimpleFOC.h>
+
+// Fault codes, latched until cleared
+#define FAULT_NONE          0x0000u
+#define FAULT_STALL         0x0001u  // Commanded, but the shaft does not turn
+#define FAULT_HALL_STATE    0x0002u  // Invalid Hall state (000 or 111)
+#define FAULT_HALL_EDGE     0x0004u  // Commanded, but no Hall edges arrive
+#define FAULT_OVERSPEED     0x0008u  // Shaft velocity above the trip limit
+#define FAULT_CMD_TIMEOUT   0x0010u  // No valid command within the timeout
+
+// Faults which disable the driver. The command timeout only ramps down.
+#define FAULT_TRIP_MASK     (FAULT_STALL | FAULT_HALL_STATE | FAULT_HALL_EDGE | FAULT_OVERSPEED)
+
+class faultSupervisor {
+public:
+  faultSupervisor();
+
+  void begin(BLDCMotor *motor, HallSensor *sensor);
+
+  // Evaluate all checks, call at a fixed rate (the velocity task). Constant cost.
+  void run();
+
+  // Report a valid command, restarts the command watchdog
+  void feed();
+
+  uint16_t get_faults();
+  bool is_tripped();
+
+  // Clear the latched faults and re-enable the motor
+  void clear_faults();
+
+  void onFault(void (*user_onfault_callback)(uint16_t));
+
+  // Configuration
+  void set_stall_detection(float min_target, float min_velocity, uint32_t time_ms);
+  void set_hall_edge_timeout(uint32_t time_ms);
+  void set_hall_state_limit(uint8_t count);
+  void set_overspeed_ratio(float ratio);
+
+  // A timeout of 0 disables the command watchdog
+  void set_cmd_timeout(uint32_t time_ms);
+  uint32_t get_cmd_timeout();
+  void set_ramp_down_rate(float rate);
+
+private:
+  void latch(uint16_t fault);
+  void trip();
+  void ramp_down(uint32_t now_us);
+
+  BLDCMotor *_motor;
+  HallSensor *_sensor;
+
+  volatile uint16_t _faults;
+  uint16_t _reported;
+  void (*user_onfault_callback)(uint16_t);
+
+  // Stall / missing Hall edges
+  struct stall_t {
+    float min_target;     // [rad/s] below this target no checks are done
+    float min_velocity;   // [rad/s]
+    uint32_t time_ms;
+    uint32_t edge_timeout_ms;
+    uint32_t slow_since_ms;
+    uint32_t last_edge_ms;
+    long last_edge_count;
+  };
+  stall_t _stall { 5.0f, 1.0f, 500u, 250u, 0u, 0u, 0 };
+
+  // Invalid Hall state, debounced over consecutive passes
+  uint8_t _hall_state_limit { 3u };
+  uint8_t _hall_state_count { 0u };
+
+  // Over-speed, relative to the motor velocity_limit
+  float _overspeed_ratio { 1.2f };
+
+  // Command watchdog
+  struct watchdog_t {
+    uint32_t timeout_ms;
+    float ramp_rate;      // [rad/s^2]
+    uint32_t last_cmd_ms;
+    uint32_t last_ramp_us;
+    bool ramping;
+  };
+  watchdog_t _watchdog { 0u, 200.0f, 0u, 0u, false };
+};
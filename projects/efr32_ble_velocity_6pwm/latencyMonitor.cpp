@@ -0,0 +1,277 @@
+/***************************************************************************//**
+ * @file latencyMonitor.cpp
+ * @brief Command latency measurement
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "latencyMonitor.h"
+
+latencyMonitor latency;
+
+static const char *const segment_names[latencyMonitor::SEG_COUNT] = {
+  "link", "buffer", "loop", "response", "total"
+};
+
+latencyMonitor::latencyMonitor() :
+  _probes(),
+  _sync(),
+  _central_us(0u),
+  _central_valid(false),
+  _timeouts(0u),
+  _histograms()
+{
+  reset();
+}
+
+void latencyMonitor::sync_request(uint32_t central_us, uint32_t rx_us, Print &out)
+{
+  _sync.t1 = central_us;
+  _sync.t2 = rx_us;
+  _sync.t3 = micros();
+  _sync.requested = true;
+
+  out.print("Y");
+  out.print(_sync.t1);
+  out.print(" ");
+  out.print(_sync.t2);
+  out.print(" ");
+  out.println(_sync.t3);
+}
+
+void latencyMonitor::sync_finish(uint32_t central_us)
+{
+  if (!_sync.requested) {
+    return;
+  }
+  _sync.requested = false;
+
+  // Both differences are taken on one clock
+  uint32_t rtt = (central_us - _sync.t1) - (_sync.t3 - _sync.t2);
+  if ((int32_t)rtt < 0) {
+    return;
+  }
+
+  sync_sample_t &sample = _sync.samples[_sync.count % LATENCY_SYNC_SAMPLES];
+  // Wrapping arithmetic, the clocks can be any distance apart
+  sample.offset_us = (_sync.t2 - _sync.t1) - rtt / 2u;
+  sample.rtt_us = rtt;
+  _sync.count++;
+
+  // The shortest round trip has the least asymmetric delay
+  size_t n = _sync.count < LATENCY_SYNC_SAMPLES ? _sync.count : LATENCY_SYNC_SAMPLES;
+  const sync_sample_t *best = &_sync.samples[0];
+  for (size_t i = 1; i < n; ++i) {
+    if (_sync.samples[i].rtt_us < best->rtt_us) {
+      best = &_sync.samples[i];
+    }
+  }
+  _sync.offset_us = best->offset_us;
+  _sync.rtt_us = best->rtt_us;
+}
+
+bool latencyMonitor::is_synced()
+{
+  return _sync.count > 0u;
+}
+
+uint32_t latencyMonitor::get_offset()
+{
+  return _sync.offset_us;
+}
+
+uint32_t latencyMonitor::get_rtt()
+{
+  return _sync.rtt_us;
+}
+
+void latencyMonitor::set_central_timestamp(uint32_t central_us)
+{
+  _central_us = central_us;
+  _central_valid = true;
+}
+
+void latencyMonitor::command_dispatched(size_t axis, bool from_ble, uint32_t rx_us, uint32_t dispatch_us,
+                                        float new_target, float velocity)
+{
+  uint32_t start_us = rx_us;
+  if (from_ble && _central_valid && is_synced()) {
+    uint32_t sent_us = _central_us + _sync.offset_us;
+    record(SEG_LINK, (int32_t)(rx_us - sent_us));
+    start_us = sent_us;
+  }
+  _central_valid = false;
+
+  record(SEG_BUFFER, (int32_t)(dispatch_us - rx_us));
+
+  if (axis >= LATENCY_MAX_AXES) {
+    return;
+  }
+
+  // Only steps which the shaft visibly follows get a response time
+  float step = new_target - velocity;
+  probe_t &probe = _probes[axis];
+  if (fabsf(step) < 2.0f * LATENCY_RESPONSE_MIN) {
+    probe.active = false;
+    return;
+  }
+
+  float threshold = fmaxf(0.1f * fabsf(step), LATENCY_RESPONSE_MIN);
+  probe.active = true;
+  probe.moved = false;
+  probe.rx_us = start_us;
+  probe.dispatch_us = dispatch_us;
+  probe.move_us = 0u;
+  probe.start_velocity = velocity;
+  probe.threshold = step > 0.0f ? threshold : -threshold;
+}
+
+void latencyMonitor::before_move(size_t axis)
+{
+  if (axis >= LATENCY_MAX_AXES) {
+    return;
+  }
+
+  probe_t &probe = _probes[axis];
+  if (probe.active && !probe.moved) {
+    probe.moved = true;
+    probe.move_us = micros();
+    record(SEG_LOOP, (int32_t)(probe.move_us - probe.dispatch_us));
+  }
+}
+
+void latencyMonitor::after_move(size_t axis, float velocity)
+{
+  if (axis >= LATENCY_MAX_AXES) {
+    return;
+  }
+
+  probe_t &probe = _probes[axis];
+  if (!probe.active || !probe.moved) {
+    return;
+  }
+
+  uint32_t now = micros();
+  float change = velocity - probe.start_velocity;
+  bool responded = probe.threshold > 0.0f ? change >= probe.threshold : change <= probe.threshold;
+  if (responded) {
+    record(SEG_RESPONSE, (int32_t)(now - probe.move_us));
+    record(SEG_TOTAL, (int32_t)(now - probe.rx_us));
+    probe.active = false;
+  } else if (now - probe.move_us >= LATENCY_RESPONSE_TIMEOUT_US) {
+    _timeouts++;
+    probe.active = false;
+  }
+}
+
+const latencyMonitor::histogram_t &latencyMonitor::get_histogram(segment_t segment)
+{
+  return _histograms[segment < SEG_COUNT ? segment : SEG_TOTAL];
+}
+
+void latencyMonitor::reset()
+{
+  for (size_t i = 0; i < SEG_COUNT; ++i) {
+    _histograms[i] = histogram_t();
+    _histograms[i].min_us = UINT32_MAX;
+  }
+  for (size_t i = 0; i < LATENCY_MAX_AXES; ++i) {
+    _probes[i].active = false;
+  }
+  _timeouts = 0u;
+}
+
+void latencyMonitor::record(segment_t segment, int32_t elapsed_us)
+{
+  // Residual sync error can make short segments slightly negative
+  uint32_t us = elapsed_us > 0 ? (uint32_t)elapsed_us : 0u;
+
+  histogram_t &histogram = _histograms[segment];
+  histogram.count++;
+  histogram.sum_us += us;
+  if (us < histogram.min_us) {
+    histogram.min_us = us;
+  }
+  if (us > histogram.max_us) {
+    histogram.max_us = us;
+  }
+
+  // Bin k holds [2^(k-1), 2^k) us, bin 0 holds 0 us
+  size_t bin = 0u;
+  while (us && bin < LATENCY_BINS - 1u) {
+    us >>= 1;
+    bin++;
+  }
+  histogram.bins[bin]++;
+}
+
+static uint32_t percentile(const latencyMonitor::histogram_t &histogram, uint32_t percent)
+{
+  // Upper edge of the bin, limited by the largest sample
+  uint32_t rank = (histogram.count * percent + 99u) / 100u;
+  uint32_t sum = 0u;
+  for (size_t i = 0; i < LATENCY_BINS; ++i) {
+    sum += histogram.bins[i];
+    if (sum >= rank) {
+      uint32_t upper = i ? (1u << i) - 1u : 0u;
+      return upper < histogram.max_us ? upper : histogram.max_us;
+    }
+  }
+  return histogram.max_us;
+}
+
+void latencyMonitor::print(Print &out)
+{
+  out.print("SYNC samples:");
+  out.print(_sync.count);
+  out.print(" offset:");
+  out.print(_sync.offset_us);
+  out.print(" rtt:");
+  out.println(_sync.rtt_us);
+
+  for (size_t i = 0; i < SEG_COUNT; ++i) {
+    const histogram_t &histogram = _histograms[i];
+    out.print("LAT ");
+    out.print(segment_names[i]);
+    out.print(" n:");
+    out.print(histogram.count);
+    if (histogram.count) {
+      out.print(" min:");
+      out.print(histogram.min_us);
+      out.print(" avg:");
+      out.print((uint32_t)(histogram.sum_us / histogram.count));
+      out.print(" p50:");
+      out.print(percentile(histogram, 50u));
+      out.print(" p99:");
+      out.print(percentile(histogram, 99u));
+      out.print(" max:");
+      out.print(histogram.max_us);
+    }
+    out.println();
+  }
+
+  out.print("LAT timeouts:");
+  out.println(_timeouts);
+}
@@ -0,0 +1,149 @@
+/***************************************************************************//**
+ * @file latencyMonitor.h
+ * @brief Command latency measurement header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+
+#ifndef LATENCY_MAX_AXES
+#define LATENCY_MAX_AXES 3u
+#endif
+
+#ifndef LATENCY_BINS
+#define LATENCY_BINS 24u  // log2 bins, the last one holds >= 2^(LATENCY_BINS - 1) us
+#endif
+
+#ifndef LATENCY_SYNC_SAMPLES
+#define LATENCY_SYNC_SAMPLES 8u
+#endif
+
+#ifndef LATENCY_RESPONSE_MIN
+#define LATENCY_RESPONSE_MIN 0.5f  // Smallest velocity change which counts as response [rad/s]
+#endif
+
+#ifndef LATENCY_RESPONSE_TIMEOUT_US
+#define LATENCY_RESPONSE_TIMEOUT_US 2000000u
+#endif
+
+// End-to-end latency of the target commands, split at the points the command
+// passes on the device:
+//  central write -> handle_gatt_data_receive()  link   (needs time sync and '@')
+//                -> Commander dispatch          buffer (Rx buffer, comms rate, parsing)
+//                -> first move() with the target loop
+//                -> shaft velocity responds     response
+// Total is from the central write when the link is known, from the receive
+// otherwise. Serial commands start at the dispatch.
+//
+// Time sync, NTP style with the central timestamps t1 and t4:
+//  central: Y<t1>   device: Y<t1> <t2> <t3>   central: YF<t4>
+// t2 is the receive and t3 the reply time of the device. The offset of the
+// sample with the shortest round trip of the last LATENCY_SYNC_SAMPLES is used.
+class latencyMonitor {
+public:
+  latencyMonitor();
+
+  enum segment_t {
+    SEG_LINK = 0,
+    SEG_BUFFER,
+    SEG_LOOP,
+    SEG_RESPONSE,
+    SEG_TOTAL,
+    SEG_COUNT,
+  };
+
+  struct histogram_t {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t bins[LATENCY_BINS];
+  };
+
+  // Time sync
+  void sync_request(uint32_t central_us, uint32_t rx_us, Print &out);
+  void sync_finish(uint32_t central_us);
+  bool is_synced();
+  uint32_t get_offset();  // Device minus central time [us], modulo 2^32
+  uint32_t get_rtt();
+
+  // Central send time of the next command, from the '@' command
+  void set_central_timestamp(uint32_t central_us);
+
+  // A target command was dispatched by Commander. rx_us is the receive time,
+  // equal to dispatch_us for serial commands.
+  void command_dispatched(size_t axis, bool from_ble, uint32_t rx_us, uint32_t dispatch_us,
+                          float new_target, float velocity);
+
+  // Call around the move() of the axis
+  void before_move(size_t axis);
+  void after_move(size_t axis, float velocity);
+
+  const histogram_t &get_histogram(segment_t segment);
+  void reset();
+  void print(Print &out);
+
+private:
+  void record(segment_t segment, int32_t elapsed_us);
+
+  struct probe_t {
+    bool active;
+    bool moved;
+    uint32_t rx_us;
+    uint32_t dispatch_us;
+    uint32_t move_us;
+    float start_velocity;
+    float threshold;      // Signed velocity change which counts as response
+  };
+  probe_t _probes[LATENCY_MAX_AXES];
+
+  struct sync_sample_t {
+    uint32_t offset_us;
+    uint32_t rtt_us;
+  };
+
+  struct sync_t {
+    uint32_t t1;
+    uint32_t t2;
+    uint32_t t3;
+    bool requested;
+    sync_sample_t samples[LATENCY_SYNC_SAMPLES];
+    uint32_t count;
+    uint32_t offset_us;
+    uint32_t rtt_us;
+  };
+  sync_t _sync;
+
+  uint32_t _central_us;
+  bool _central_valid;
+  uint32_t _timeouts;
+
+  histogram_t _histograms[SEG_COUNT];
+};
+
+extern latencyMonitor latency;
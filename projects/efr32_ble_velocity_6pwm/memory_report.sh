@@ -0,0 +1,116 @@
+#!/bin/sh
+
+# Per-module RAM/flash/stack budget report of a sketch build.
+# Fails if a sketch module references a heap allocator.
+#
+# Usage: memory_report.sh <build path>
+
+BUILD_PATH="$1"
+
+if [ -z "$BUILD_PATH" ] || [ ! -d "$BUILD_PATH" ]; then
+    echo "Error: Build path '$BUILD_PATH' does not exist" >&2
+    exit 1
+fi
+
+# Device memory, EFR32MG24 (Nano Matter) and MGM240P (Thing Plus Matter)
+FLASH_SIZE="${FLASH_SIZE:-1572864}"
+RAM_SIZE="${RAM_SIZE:-262144}"
+
+# Heap allocator symbols which must not be referenced by the sketch
+HEAP_SYMBOLS="malloc calloc realloc strdup _Znwj _Znaj _ZnwjRKSt9nothrow_t _ZnajRKSt9nothrow_t"
+
+# Find the toolchain, either from PATH or from the Arduino data directory
+find_tool() {
+    if command -v "$1" >/dev/null 2>&1; then
+        command -v "$1"
+        return
+    fi
+    data_dir="$(arduino-cli config get directories.data 2>/dev/null)"
+    data_dir="${data_dir:-$HOME/.arduino15}"
+    find "$data_dir/packages" -type f -name "$1" 2>/dev/null | sort | tail -n 1
+}
+
+SIZE="$(find_tool arm-none-eabi-size)"
+NM="$(find_tool arm-none-eabi-nm)"
+
+if [ -z "$SIZE" ] || [ -z "$NM" ]; then
+    echo "Error: arm-none-eabi-size or arm-none-eabi-nm not found" >&2
+    exit 1
+fi
+
+# Print "<flash> <ram>" of the given object files
+object_size() {
+    "$SIZE" -t "$@" 2>/dev/null | awk 'END { print $1 + $2, $2 + $3 }'
+}
+
+# Print the largest stack frame of the given .su files
+stack_size() {
+    if [ $# -eq 0 ]; then
+        echo 0
+        return
+    fi
+    cat "$@" 2>/dev/null | awk -F'\t' 'BEGIN { max = 0 } $2 + 0 > max { max = $2 + 0 } END { print max }'
+}
+
+print_row() {
+    printf "%-32s %10s %10s %10s\n" "$1" "$2" "$3" "$4"
+}
+
+echo "=========================================="
+echo "Memory budget report: $BUILD_PATH"
+echo "=========================================="
+print_row "Module" "Flash [B]" "RAM [B]" "Stack [B]"
+
+# Sketch modules
+for obj in "$BUILD_PATH"/sketch/*.o; do
+    [ -f "$obj" ] || continue
+    module="$(basename "$obj" .o)"
+    set -- $(object_size "$obj")
+    print_row "$module" "$1" "$2" "$(stack_size "${obj%.o}.su")"
+done
+
+# Libraries and core, aggregated
+for dir in "$BUILD_PATH"/libraries/* "$BUILD_PATH"/core; do
+    [ -d "$dir" ] || continue
+    objs="$(find "$dir" -name '*.o' | tr '\n' ' ')"
+    [ -n "$objs" ] || continue
+    sus="$(find "$dir" -name '*.su' | tr '\n' ' ')"
+    set -- $(object_size $objs)
+    print_row "[$(basename "$dir")]" "$1" "$2" "$(stack_size $sus)"
+done
+
+# Totals from the linked image
+elf="$(find "$BUILD_PATH" -maxdepth 1 -name '*.elf' | head -n 1)"
+if [ -n "$elf" ]; then
+    set -- $(object_size "$elf")
+    echo "------------------------------------------"
+    print_row "Total" "$1" "$2" ""
+    echo "Flash: $1 / $FLASH_SIZE B ($(( $1 * 100 / FLASH_SIZE ))%)"
+    echo "RAM:   $2 / $RAM_SIZE B ($(( $2 * 100 / RAM_SIZE ))%)"
+fi
+
+if ! ls "$BUILD_PATH"/sketch/*.su >/dev/null 2>&1; then
+    echo "Note: no stack usage data, build with -fstack-usage"
+fi
+
+# The sketch has to be heap-free at runtime
+heap_users=""
+for obj in "$BUILD_PATH"/sketch/*.o; do
+    [ -f "$obj" ] || continue
+    for sym in $("$NM" -u "$obj" | awk '{ print $2 }'); do
+        for heap_sym in $HEAP_SYMBOLS; do
+            if [ "$sym" = "$heap_sym" ]; then
+                heap_users="$heap_users  - $(basename "$obj" .o): $sym
+"
+            fi
+        done
+    done
+done
+
+echo "=========================================="
+if [ -n "$heap_users" ]; then
+    echo "Error: Heap allocation referenced by the sketch:" >&2
+    printf "%s" "$heap_users" >&2
+    exit 1
+fi
+echo "Heap check passed: no heap allocation in the sketch"
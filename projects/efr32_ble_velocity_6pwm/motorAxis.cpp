@@ -0,0 +1,112 @@
+/***************************************************************************//**
+ * @file motorAxis.cpp
+ * @brief Motor axis (driver, sensor, motor) implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "motorAxis.h"
+
+motorAxis::motorAxis(
+  char id,
+  int pwm_1h, int pwm_1l,
+  int pwm_2h, int pwm_2l,
+  int pwm_3h, int pwm_3l,
+  int pwm_en,
+  int hall_a, int hall_b, int hall_c,
+  int pole_pairs
+  ) :
+  id(id),
+  driver(pwm_1h, pwm_1l, pwm_2h, pwm_2l, pwm_3h, pwm_3l, pwm_en),
+  sensor(hall_a, hall_b, hall_c, pole_pairs),
+  motor(pole_pairs),
+  ready(false),
+  hall_isr_count { 0u, 0u, 0u }
+{
+}
+
+void motorAxis::loop_foc()
+{
+  uint32_t start = micros();
+  motor.loopFOC();
+  update_loop_time(_foc_time, micros() - start);
+}
+
+void motorAxis::move()
+{
+  uint32_t start = micros();
+  motor.move();
+  update_loop_time(_move_time, micros() - start);
+}
+
+const motorAxis::loop_time_t &motorAxis::get_foc_time()
+{
+  return _foc_time;
+}
+
+const motorAxis::loop_time_t &motorAxis::get_move_time()
+{
+  return _move_time;
+}
+
+void motorAxis::reset_loop_time()
+{
+  _foc_time = { 0u, 0u, 0u, 0u };
+  _move_time = { 0u, 0u, 0u, 0u };
+}
+
+void motorAxis::print_loop_time(Print &out)
+{
+  out.print(id);
+  print_loop_time(out, " foc:", _foc_time);
+  print_loop_time(out, " move:", _move_time);
+  out.println();
+}
+
+void motorAxis::update_loop_time(loop_time_t &time, uint32_t elapsed_us)
+{
+  time.last_us = elapsed_us;
+  if (elapsed_us > time.max_us) {
+    time.max_us = elapsed_us;
+  }
+  if (time.sum_us + elapsed_us < time.sum_us) {
+    // Restart the average before the sum overflows
+    time.sum_us = 0u;
+    time.count = 0u;
+  }
+  time.sum_us += elapsed_us;
+  time.count++;
+}
+
+void motorAxis::print_loop_time(Print &out, const char *name, const loop_time_t &time)
+{
+  // last/max/avg [us]
+  out.print(name);
+  out.print(time.last_us);
+  out.print('/');
+  out.print(time.max_us);
+  out.print('/');
+  out.print(time.count ? time.sum_us / time.count : 0u);
+}
@@ -0,0 +1,87 @@
+/***************************************************************************//**
+ * @file motorAxis.h
+ * @brief Motor axis (driver, sensor, motor) header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+#include <SimpleFOC.h>
+#include "faultSupervisor.h"
+#include "motorParams.h"
+
+// One motor axis: driver, Hall sensor, motor, fault supervisor and runtime
+// parameters in static storage plus the loop time statistics of the axis.
+class motorAxis {
+public:
+  motorAxis(
+    char id,
+    int pwm_1h, int pwm_1l,
+    int pwm_2h, int pwm_2l,
+    int pwm_3h, int pwm_3l,
+    int pwm_en,
+    int hall_a, int hall_b, int hall_c,
+    int pole_pairs);
+
+  // Commander id of the axis, also used to address telemetry
+  const char id;
+
+  BLDCDriver6PWM driver;
+  HallSensor sensor;
+  BLDCMotor motor;
+  faultSupervisor supervisor;
+  motorParams params;
+
+  bool ready;
+
+  // Hall A/B/C interrupt counters, incremented by the ISRs
+  volatile uint32_t hall_isr_count[3];
+
+  // Timed wrappers of BLDCMotor::loopFOC() and BLDCMotor::move()
+  void loop_foc();
+  void move();
+
+  // Loop time
+  struct loop_time_t {
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t sum_us;
+    uint32_t count;
+  };
+
+  const loop_time_t &get_foc_time();
+  const loop_time_t &get_move_time();
+  void reset_loop_time();
+  void print_loop_time(Print &out);
+
+private:
+  static void update_loop_time(loop_time_t &time, uint32_t elapsed_us);
+  static void print_loop_time(Print &out, const char *name, const loop_time_t &time);
+
+  loop_time_t _foc_time { 0u, 0u, 0u, 0u };
+  loop_time_t _move_time { 0u, 0u, 0u, 0u };
+};
@@ -0,0 +1,289 @@
+/***************************************************************************//**
+ * @file motorParams.cpp
+ * @brief Double-buffered motor parameters implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "motorParams.h"
+
+motorParams::motorParams() :
+  _motor(nullptr),
+  _shadow(),
+  _active(),
+  _previous(),
+  _pending(false),
+  _auto_commit(true),
+  _version(0u)
+{
+}
+
+void motorParams::begin(BLDCMotor *motor)
+{
+  _motor = motor;
+
+  params_t &params = _active;
+  params.velocity_p = motor->PID_velocity.P;
+  params.velocity_i = motor->PID_velocity.I;
+  params.velocity_d = motor->PID_velocity.D;
+  params.velocity_ramp = motor->PID_velocity.output_ramp;
+  params.velocity_output_limit = motor->PID_velocity.limit;
+  params.velocity_tf = motor->LPF_velocity.Tf;
+  params.velocity_limit = motor->velocity_limit;
+  params.voltage_limit = motor->voltage_limit;
+  params.current_limit = motor->current_limit;
+
+  _shadow = _active;
+  _previous = _active;
+  _pending = false;
+}
+
+bool motorParams::stage_command(Commander &command, char *cmd)
+{
+  if (!_motor || (cmd[0] != 'V' && cmd[0] != 'L')) {
+    return false;
+  }
+
+  taskENTER_CRITICAL();
+  params_t before = _shadow;
+  taskEXIT_CRITICAL();
+
+  params_t params = before;
+
+  if (cmd[0] == 'V') {
+    // Commander parses into these, locals keep concurrent callers apart
+    PIDController pid_edit { params.velocity_p, params.velocity_i, params.velocity_d,
+                             params.velocity_ramp, params.velocity_output_limit };
+    LowPassFilter lpf_edit { params.velocity_tf };
+
+    // Same sub-commands as Commander::motor()
+    if (cmd[1] == 'F') {
+      command.lpf(&lpf_edit, &cmd[1]);
+    } else {
+      command.pid(&pid_edit, &cmd[1]);
+    }
+
+    params.velocity_p = pid_edit.P;
+    params.velocity_i = pid_edit.I;
+    params.velocity_d = pid_edit.D;
+    params.velocity_ramp = pid_edit.output_ramp;
+    params.velocity_output_limit = pid_edit.limit;
+    params.velocity_tf = lpf_edit.Tf;
+
+    taskENTER_CRITICAL();
+    _shadow.velocity_p = params.velocity_p;
+    _shadow.velocity_i = params.velocity_i;
+    _shadow.velocity_d = params.velocity_d;
+    _shadow.velocity_ramp = params.velocity_ramp;
+    _shadow.velocity_output_limit = params.velocity_output_limit;
+    _shadow.velocity_tf = params.velocity_tf;
+    taskEXIT_CRITICAL();
+  } else {
+    float *value;
+    switch (cmd[1]) {
+      case 'V':
+        value = &params.velocity_limit;
+        break;
+      case 'U':
+        value = &params.voltage_limit;
+        break;
+      case 'C':
+        value = &params.current_limit;
+        break;
+      default:
+        // Let Commander::motor() report the error
+        return false;
+    }
+
+    command.scalar(value, &cmd[2]);
+
+    // Same dependent limits as the Commander 'L' command
+    bool current_sense = _motor->current_sense != nullptr;
+    taskENTER_CRITICAL();
+    switch (cmd[1]) {
+      case 'V':
+        _shadow.velocity_limit = params.velocity_limit;
+        break;
+      case 'U':
+        _shadow.voltage_limit = params.voltage_limit;
+        if (!current_sense) {
+          _shadow.velocity_output_limit = params.voltage_limit;
+        }
+        break;
+      default:
+        _shadow.current_limit = params.current_limit;
+        if (current_sense) {
+          _shadow.velocity_output_limit = params.current_limit;
+        }
+        break;
+    }
+    taskEXIT_CRITICAL();
+  }
+
+  staged(before);
+  return true;
+}
+
+void motorParams::stage_velocity_pid(float p, float i, float d)
+{
+  taskENTER_CRITICAL();
+  params_t before = _shadow;
+  _shadow.velocity_p = p;
+  _shadow.velocity_i = i;
+  _shadow.velocity_d = d;
+  taskEXIT_CRITICAL();
+
+  staged(before);
+}
+
+void motorParams::stage_limits(float velocity, float voltage, float current)
+{
+  if (!_motor) {
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  params_t before = _shadow;
+  _shadow.velocity_limit = velocity;
+  _shadow.voltage_limit = voltage;
+  _shadow.current_limit = current;
+  // Same dependent limits as the Commander 'L' command
+  _shadow.velocity_output_limit = _motor->current_sense ? current : voltage;
+  taskEXIT_CRITICAL();
+
+  staged(before);
+}
+
+void motorParams::set_auto_commit(bool enable)
+{
+  _auto_commit = enable;
+}
+
+bool motorParams::get_auto_commit()
+{
+  return _auto_commit;
+}
+
+void motorParams::commit()
+{
+  _pending = true;
+}
+
+void motorParams::rollback()
+{
+  taskENTER_CRITICAL();
+  _shadow = _previous;
+  taskEXIT_CRITICAL();
+
+  commit();
+}
+
+bool motorParams::apply()
+{
+  if (!_pending || !_motor) {
+    return false;
+  }
+
+  taskENTER_CRITICAL();
+  _previous = _active;
+  _active = _shadow;
+  _pending = false;
+  taskEXIT_CRITICAL();
+
+  write_motor(_active);
+  _version++;
+
+  return true;
+}
+
+uint32_t motorParams::get_version()
+{
+  return _version;
+}
+
+bool motorParams::is_pending()
+{
+  return _pending;
+}
+
+void motorParams::print(Print &out)
+{
+  const params_t *sets[] = { &_active, &_shadow };
+  const char *names[] = { " active", " shadow" };
+
+  for (size_t i = 0; i < 2u; ++i) {
+    const params_t &params = *sets[i];
+    out.print(names[i]);
+    out.print(" vel_pid:");
+    out.print(params.velocity_p, 4);
+    out.print('/');
+    out.print(params.velocity_i, 4);
+    out.print('/');
+    out.print(params.velocity_d, 4);
+    out.print(" ramp:");
+    out.print(params.velocity_ramp);
+    out.print(" out:");
+    out.print(params.velocity_output_limit);
+    out.print(" tf:");
+    out.print(params.velocity_tf, 4);
+    out.print(" limits:");
+    out.print(params.velocity_limit);
+    out.print('/');
+    out.print(params.voltage_limit);
+    out.print('/');
+    out.println(params.current_limit);
+  }
+}
+
+void motorParams::staged(const params_t &before)
+{
+  // Queries and unchanged values do not create a new version
+  taskENTER_CRITICAL();
+  bool changed = memcmp(&before, &_shadow, sizeof(params_t)) != 0;
+  taskEXIT_CRITICAL();
+
+  if (_auto_commit && changed) {
+    commit();
+  }
+}
+
+void motorParams::write_motor(const params_t &params)
+{
+  BLDCMotor *motor = _motor;
+
+  motor->PID_velocity.P = params.velocity_p;
+  motor->PID_velocity.I = params.velocity_i;
+  motor->PID_velocity.D = params.velocity_d;
+  motor->PID_velocity.output_ramp = params.velocity_ramp;
+  motor->PID_velocity.limit = params.velocity_output_limit;
+  motor->LPF_velocity.Tf = params.velocity_tf;
+
+  motor->velocity_limit = params.velocity_limit;
+  motor->P_angle.limit = params.velocity_limit;
+  motor->voltage_limit = params.voltage_limit;
+  motor->PID_current_q.limit = params.voltage_limit;
+  motor->PID_current_d.limit = params.voltage_limit;
+  motor->current_limit = params.current_limit;
+}
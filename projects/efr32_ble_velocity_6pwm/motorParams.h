@@ -0,0 +1,95 @@
+/***************************************************************************//**
+ * @file motorParams.h
+ * @brief Double-buffered motor parameters header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "Arduino.h"
+#include <SimpleFOC.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Double-buffered runtime parameters of a motor: the velocity PID, its low
+// pass filter and the limits. Commands write a shadow copy, commit() hands
+// it to the control loop, which swaps it in at once by apply() between two
+// loop iterations. The set replaced by the last commit is kept for rollback.
+class motorParams {
+public:
+  struct params_t {
+    float velocity_p;
+    float velocity_i;
+    float velocity_d;
+    float velocity_ramp;
+    float velocity_output_limit;  // Voltage or current, the torque target
+    float velocity_tf;
+    float velocity_limit;
+    float voltage_limit;
+    float current_limit;
+  };
+
+  motorParams();
+
+  // Takes the active set from the configured motor
+  void begin(BLDCMotor *motor);
+
+  // Staging, safe from any task. Returns false if the command is not a
+  // velocity PID ('V') or limit ('L') motor command.
+  bool stage_command(Commander &command, char *cmd);
+  void stage_velocity_pid(float p, float i, float d);
+  void stage_limits(float velocity, float voltage, float current);
+
+  // With auto-commit every staged change is committed on its own
+  void set_auto_commit(bool enable);
+  bool get_auto_commit();
+
+  void commit();
+  // Stages and commits the set replaced by the last commit
+  void rollback();
+
+  // Call at a loop boundary, applies a pending commit. Returns true if
+  // the parameters changed.
+  bool apply();
+
+  uint32_t get_version();
+  bool is_pending();
+  void print(Print &out);
+
+private:
+  void staged(const params_t &before);
+  void write_motor(const params_t &params);
+
+  BLDCMotor *_motor;
+
+  params_t _shadow;
+  params_t _active;
+  params_t _previous;
+
+  volatile bool _pending;
+  bool _auto_commit;
+  uint32_t _version;
+};
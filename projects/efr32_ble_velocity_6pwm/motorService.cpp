@@ -0,0 +1,309 @@
+/***************************************************************************//**
+ * @file motorService.cpp
+ * @brief BLE motor control GATT service implementation
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#include "motorService.h"
+
+#define GATTDB_NON_ADVERTISED_SERVICE 0x00
+
+// ATT error codes
+#define ATT_ERR_INVALID_OFFSET         0x07
+#define ATT_ERR_INVALID_VALUE_LENGTH   0x0D
+#define ATT_ERR_VALUE_NOT_ALLOWED      0x13
+
+// Properties of the characteristics, in characteristic_t order
+static const uint16_t motor_service_properties[] = {
+  SL_BT_GATTDB_CHARACTERISTIC_READ,
+  SL_BT_GATTDB_CHARACTERISTIC_READ | SL_BT_GATTDB_CHARACTERISTIC_NOTIFY,
+  SL_BT_GATTDB_CHARACTERISTIC_READ | SL_BT_GATTDB_CHARACTERISTIC_WRITE | SL_BT_GATTDB_CHARACTERISTIC_NOTIFY,
+  SL_BT_GATTDB_CHARACTERISTIC_READ | SL_BT_GATTDB_CHARACTERISTIC_WRITE,
+  SL_BT_GATTDB_CHARACTERISTIC_READ | SL_BT_GATTDB_CHARACTERISTIC_WRITE,
+  SL_BT_GATTDB_CHARACTERISTIC_READ | SL_BT_GATTDB_CHARACTERISTIC_NOTIFY,
+};
+
+static const uint16_t motor_service_uuids[] = {
+  MOTOR_SERVICE_UUID_AXIS,
+  MOTOR_SERVICE_UUID_VELOCITY,
+  MOTOR_SERVICE_UUID_TARGET,
+  MOTOR_SERVICE_UUID_PID,
+  MOTOR_SERVICE_UUID_LIMITS,
+  MOTOR_SERVICE_UUID_STATUS,
+};
+
+motorService::motorService() :
+  _axis(nullptr),
+  _notify_period_ms(100u),
+  _last_notify_ms(0u)
+{
+  for (auto & it : _handles) {
+    it = 0xFFFF;
+  }
+}
+
+void motorService::begin(motorAxis *axis, uint32_t notify_period_ms)
+{
+  _axis = axis;
+  _notify_period_ms = notify_period_ms;
+  _last_notify_ms = millis();
+}
+
+uuid_128 motorService::uuid(uint16_t id)
+{
+  // bdd1xxxx-a80f-4758-a4d1-7f4aee2d718e, little endian
+  uuid_128 uuid = {
+    .data = { 0x8e, 0x71, 0x2d, 0xee, 0x4a, 0x7f, 0xd1, 0xa4, 0x58, 0x47, 0x0f, 0xa8, 0x00, 0x00, 0xd1, 0xbd, }
+  };
+  uuid.data[12] = (uint8_t)(id & 0xFF);
+  uuid.data[13] = (uint8_t)(id >> 8);
+  return uuid;
+}
+
+// BLE:GATT DB
+void motorService::init_gattdb(uint16_t session_id)
+{
+  sl_status_t sc;
+  uint16_t service_handle;
+
+  // Add the motor control service to the GATT DB
+  // UUID: bdd10000-a80f-4758-a4d1-7f4aee2d718e
+  uuid_128 service_uuid = uuid(MOTOR_SERVICE_UUID_SERVICE);
+  sc = sl_bt_gattdb_add_service(
+    session_id,
+    sl_bt_gattdb_primary_service,
+    GATTDB_NON_ADVERTISED_SERVICE,
+    sizeof(service_uuid),
+    service_uuid.data,
+    &service_handle);
+  app_assert_status(sc);
+
+  // The values are user managed, so reads and writes reach the motor directly,
+  // the PID and limit writes through the parameter set of the axis
+  for (size_t i = 0; i < CH_COUNT; ++i) {
+    sc = sl_bt_gattdb_add_uuid128_characteristic(
+      session_id,
+      service_handle,
+      motor_service_properties[i],
+      0x00,
+      0x00,
+      uuid(motor_service_uuids[i]),
+      sl_bt_gattdb_user_managed_value,
+      _max_value_size,    // max length
+      0,                  // initial value length
+      nullptr,            // initial value
+      &_handles[i]);
+    app_assert_status(sc);
+  }
+
+  // Start the motor control service
+  sc = sl_bt_gattdb_start_service(session_id, service_handle);
+  app_assert_status(sc);
+}
+
+int motorService::find_characteristic(uint16_t handle)
+{
+  for (int i = 0; i < CH_COUNT; ++i) {
+    if (_handles[i] == handle) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+size_t motorService::read_value(int characteristic, uint8_t *value)
+{
+  BLDCMotor &motor = _axis->motor;
+  float values[3];
+  size_t count = 1;
+
+  switch (characteristic) {
+    case CH_AXIS:
+      value[0] = (uint8_t)_axis->id;
+      return 1u;
+
+    case CH_VELOCITY:
+      values[0] = motor.shaft_velocity;
+      break;
+
+    case CH_TARGET:
+      values[0] = motor.target;
+      break;
+
+    case CH_PID:
+      values[0] = motor.PID_velocity.P;
+      values[1] = motor.PID_velocity.I;
+      values[2] = motor.PID_velocity.D;
+      count = 3;
+      break;
+
+    case CH_LIMITS:
+      values[0] = motor.velocity_limit;
+      values[1] = motor.voltage_limit;
+      values[2] = motor.current_limit;
+      count = 3;
+      break;
+
+    case CH_STATUS: {
+      uint16_t faults = _axis->supervisor.get_faults();
+      value[0] = (uint8_t)motor.enabled;
+      memcpy(&value[1], &faults, sizeof(faults));
+      return 1u + sizeof(faults);
+    }
+
+    default:
+      return 0u;
+  }
+
+  memcpy(value, values, count * sizeof(float));
+  return count * sizeof(float);
+}
+
+uint8_t motorService::write_value(int characteristic, const uint8_t *value, size_t len)
+{
+  BLDCMotor &motor = _axis->motor;
+  float values[3];
+  size_t count = (characteristic == CH_TARGET) ? 1u : 3u;
+
+  if (len != count * sizeof(float)) {
+    return ATT_ERR_INVALID_VALUE_LENGTH;
+  }
+  memcpy(values, value, len);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!isfinite(values[i])) {
+      return ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+  }
+
+  switch (characteristic) {
+    case CH_TARGET:
+      motor.target = values[0];
+      _axis->supervisor.feed();
+      break;
+
+    // Staged, the control loop applies them on commit
+    case CH_PID:
+      _axis->params.stage_velocity_pid(values[0], values[1], values[2]);
+      break;
+
+    case CH_LIMITS:
+      if (values[0] < 0.0f || values[1] < 0.0f || values[2] < 0.0f) {
+        return ATT_ERR_VALUE_NOT_ALLOWED;
+      }
+      _axis->params.stage_limits(values[0], values[1], values[2]);
+      break;
+
+    default:
+      return ATT_ERR_VALUE_NOT_ALLOWED;
+  }
+
+  return 0u;
+}
+
+void motorService::notify(int characteristic)
+{
+  uint8_t value[_max_value_size];
+  size_t len = read_value(characteristic, value);
+  sl_bt_gatt_server_notify_all(_handles[characteristic], len, value);
+}
+
+void motorService::handle_read_request(sl_bt_msg_t *evt)
+{
+  sl_bt_evt_gatt_server_user_read_request_t *req = &evt->data.evt_gatt_server_user_read_request;
+
+  int characteristic = find_characteristic(req->characteristic);
+  if (characteristic < 0) {
+    return;
+  }
+
+  uint8_t value[_max_value_size];
+  size_t len = read_value(characteristic, value);
+  uint16_t sent_len;
+
+  if (req->offset > len) {
+    sl_bt_gatt_server_send_user_read_response(req->connection, req->characteristic,
+                                              ATT_ERR_INVALID_OFFSET, 0, nullptr, &sent_len);
+    return;
+  }
+
+  sl_bt_gatt_server_send_user_read_response(req->connection, req->characteristic, 0,
+                                            len - req->offset, &value[req->offset], &sent_len);
+}
+
+void motorService::handle_write_request(sl_bt_msg_t *evt)
+{
+  sl_bt_evt_gatt_server_user_write_request_t *req = &evt->data.evt_gatt_server_user_write_request;
+
+  int characteristic = find_characteristic(req->characteristic);
+  if (characteristic < 0) {
+    return;
+  }
+
+  uint8_t att_error = req->offset ? ATT_ERR_INVALID_OFFSET
+                      : write_value(characteristic, req->value.data, req->value.len);
+
+  if (req->att_opcode == sl_bt_gatt_server_write_request) {
+    sl_bt_gatt_server_send_user_write_response(req->connection, req->characteristic, att_error);
+  }
+}
+
+void motorService::handle_ble_event(sl_bt_msg_t *evt)
+{
+  if (!evt || !_axis) {
+    return;
+  }
+
+  switch (SL_BT_MSG_ID(evt->header)) {
+    case sl_bt_evt_gatt_server_user_read_request_id:
+      handle_read_request(evt);
+      break;
+
+    case sl_bt_evt_gatt_server_user_write_request_id:
+      handle_write_request(evt);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void motorService::run()
+{
+  if (!_axis || _handles[CH_VELOCITY] == 0xFFFF) {
+    return;
+  }
+
+  uint32_t now = millis();
+  if (now - _last_notify_ms < _notify_period_ms) {
+    return;
+  }
+  _last_notify_ms = now;
+
+  notify(CH_VELOCITY);
+  notify(CH_TARGET);
+  notify(CH_STATUS);
+}
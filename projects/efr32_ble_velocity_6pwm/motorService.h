@@ -0,0 +1,95 @@
+/***************************************************************************//**
+ * @file motorService.h
+ * @brief BLE motor control GATT service header file
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2026 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+#pragma once
+
+#ifndef ARDUINO_SILABS_STACK_BLE_SILABS
+  #error "This library is only compatible with the Silicon Labs BLE stack. Please select 'BLE (Silabs)' in 'Tools > Protocol stack'."
+#endif
+
+#include "Arduino.h"
+extern "C" {
+  #include "sl_bluetooth.h"
+}
+#include "motorAxis.h"
+
+// Motor control UUIDs: bdd1xxxx-a80f-4758-a4d1-7f4aee2d718e
+#define MOTOR_SERVICE_UUID_SERVICE 0x0000u
+#define MOTOR_SERVICE_UUID_AXIS    0x0001u  // char,         R
+#define MOTOR_SERVICE_UUID_VELOCITY 0x0002u // float,        R/N [rad/s]
+#define MOTOR_SERVICE_UUID_TARGET  0x0003u  // float,        R/W/N
+#define MOTOR_SERVICE_UUID_PID     0x0004u  // float[3],     R/W velocity P, I, D
+#define MOTOR_SERVICE_UUID_LIMITS  0x0005u  // float[3],     R/W velocity [rad/s], voltage [V], current [A]
+#define MOTOR_SERVICE_UUID_STATUS  0x0006u  // uint8, uint16 R/N enabled, fault code
+
+// Typed GATT service of one motor axis. Every axis gets its own instance of
+// the service, told apart by the axis characteristic.
+class motorService {
+public:
+  motorService();
+
+  void begin(motorAxis *axis, uint32_t notify_period_ms = 100u);
+
+  // BLE:GATT DB, call from the onInitGATTDB callback
+  void init_gattdb(uint16_t session_id);
+
+  // Handle the user read/write requests, call from the onBLEEvent callback
+  void handle_ble_event(sl_bt_msg_t *evt);
+
+  // Send the notifications when the period has elapsed, call from loop()
+  void run();
+
+private:
+  enum characteristic_t {
+    CH_AXIS = 0,
+    CH_VELOCITY,
+    CH_TARGET,
+    CH_PID,
+    CH_LIMITS,
+    CH_STATUS,
+    CH_COUNT,
+  };
+
+  static uuid_128 uuid(uint16_t id);
+
+  int find_characteristic(uint16_t handle);
+  size_t read_value(int characteristic, uint8_t *value);
+  uint8_t write_value(int characteristic, const uint8_t *value, size_t len);
+  void notify(int characteristic);
+
+  void handle_read_request(sl_bt_msg_t *evt);
+  void handle_write_request(sl_bt_msg_t *evt);
+
+  static const size_t _max_value_size = 12u;
+
+  motorAxis *_axis;
+  uint32_t _notify_period_ms;
+  uint32_t _last_notify_ms;
+  uint16_t _handles[CH_COUNT];
+};
@@ -33,6 +33,12 @@ using namespace arduino;
 
 #define GATTDB_NON_ADVERTISED_SERVICE 0x00
 
+#define ATT_ERR_INSUFFICIENT_RESOURCES 0x11
+
+// Log through the deferred logger, when enabled with enable_log()
+#define SPP_LOG(level, fmt, ...) \
+  do { if (_log.enable) { LOG_ ## level(_log.tag, fmt, ##__VA_ARGS__); } } while (0)
+
 sppBLEClass::sppBLEClass() :
   user_checksendcondition_callback(nullptr),
   user_onbleevent_callback(nullptr),
@@ -44,6 +50,8 @@ sppBLEClass::sppBLEClass() :
   configASSERT(this->_rx_buf_mutex);
   this->_tx_buf_mutex = xSemaphoreCreateMutexStatic(&this->_tx_buf_mutex_buf);
   configASSERT(this->_tx_buf_mutex);
+
+  reset_event_stats();
 }
 
 int sppBLEClass::available()
@@ -55,7 +63,27 @@ int sppBLEClass::read()
 {
   xSemaphoreTake(_rx_buf_mutex, portMAX_DELAY);
   int data = _rx_buf.read_char();
+  if (data >= 0) {
+    // Move to the write the byte came with
+    rx_stamps_t &stamps = _rx_stamps;
+    stamps.consumed++;
+    while (stamps.tail != stamps.head
+           && (int32_t)(stamps.entries[stamps.tail % SPP_BLE_RX_STAMP_COUNT].end - stamps.consumed) < 0) {
+      stamps.tail++;
+    }
+    if (stamps.tail != stamps.head) {
+      stamps.last_us = stamps.entries[stamps.tail % SPP_BLE_RX_STAMP_COUNT].time_us;
+    }
+  }
+  if (_rx_flow.pending) {
+    complete_pending_write();
+  }
   xSemaphoreGive(_rx_buf_mutex);
+
+  if (_rx_flow.mode == RX_FLOW_CREDIT) {
+    update_credit(false);
+  }
+
   return data;
 }
 
@@ -72,7 +100,7 @@ size_t sppBLEClass::write(uint8_t data)
 size_t sppBLEClass::write(const uint8_t *buffer, size_t size)
 {
   if (_tx_buf.isFull()) {
-    log("Tx buffer overflow!");
+    SPP_LOG(WARN, "Tx buffer overflow!");
     transfer_outgoing_data();
     return -1;
   }
@@ -130,7 +158,7 @@ void sppBLEClass::set_ble_name(const char *ble_name)
     (const uint8_t*) ble_name);
 
   if (sc != SL_STATUS_OK) {
-    log("Setting new advertised name in GATT DB failed!");
+    SPP_LOG(WARN, "Setting new advertised name in GATT DB failed!");
   }
 }
 
@@ -172,7 +200,7 @@ void sppBLEClass::init_gattdb()
     &_gatt_db.generic_access_service_handle);
   app_assert_status(sc);
 
-  char dev_name[_max_ble_name_size] = { 0 };
+  static char dev_name[_max_ble_name_size];
 
   if (_gatt_db.device_name_support_uuid) {
     bd_addr address;
@@ -187,11 +215,10 @@ void sppBLEClass::init_gattdb()
              address.addr[1],
              address.addr[0]);
   } else {
-    strncpy(dev_name, _gatt_db.device_name, strlen(_gatt_db.device_name));
-    dev_name[strlen(_gatt_db.device_name)] = '\0';
+    snprintf(dev_name, sizeof(dev_name), "%s", _gatt_db.device_name);
   }
 
-  log("BLE device name:%s", dev_name);
+  SPP_LOG(INFO, "BLE device name:%s", dev_name);
 
   // Add the Device Name characteristic to the Generic Access service
   // The value of the Device Name characteristic will be advertised
@@ -229,21 +256,44 @@ void sppBLEClass::init_gattdb()
 
   // Add the 'SPP Data' characteristic to the SPP service
   // UUID: fec26ec4-6d71-4442-9f81-55bc21d658d6
+  // With write response flow control the writes are user managed, so the
+  // response can be held back until the data fits in the Rx buffer.
+  bool write_response = (_rx_flow.mode == RX_FLOW_WRITE_RESPONSE);
   uint8_t spp_data_char_init_value = 0;
   sc = sl_bt_gattdb_add_uuid128_characteristic(
     _gatt_db.session_id,
     _gatt_db.spp_service_handle,
-    SL_BT_GATTDB_CHARACTERISTIC_WRITE_NO_RESPONSE | SL_BT_GATTDB_CHARACTERISTIC_NOTIFY,
+    SL_BT_GATTDB_CHARACTERISTIC_WRITE_NO_RESPONSE | SL_BT_GATTDB_CHARACTERISTIC_NOTIFY
+    | (write_response ? SL_BT_GATTDB_CHARACTERISTIC_WRITE : 0),
     0x00,
     0x00,
     spp_data_characteristic_uuid,
-    sl_bt_gattdb_fixed_length_value,
-    _max_ble_transfer_size,             // max length
-    sizeof(spp_data_char_init_value),   // initial value length
-    &spp_data_char_init_value,          // initial value
+    write_response ? sl_bt_gattdb_user_managed_value : sl_bt_gattdb_fixed_length_value,
+    _max_ble_transfer_size,                                 // max length
+    write_response ? 0 : sizeof(spp_data_char_init_value),  // initial value length
+    write_response ? nullptr : &spp_data_char_init_value,   // initial value
     &_gatt_db.spp_data_characteristic_handle);
   app_assert_status(sc);
 
+  if (_rx_flow.mode == RX_FLOW_CREDIT) {
+    // Add the 'SPP Credit' characteristic to the SPP service
+    // UUID: ab7d4efe-f450-46fa-b74e-abd84986c2e5
+    uint32_t spp_credit_char_init_value = _data_buffer_size;
+    sc = sl_bt_gattdb_add_uuid128_characteristic(
+      _gatt_db.session_id,
+      _gatt_db.spp_service_handle,
+      SL_BT_GATTDB_CHARACTERISTIC_READ | SL_BT_GATTDB_CHARACTERISTIC_NOTIFY,
+      0x00,
+      0x00,
+      spp_credit_characteristic_uuid,
+      sl_bt_gattdb_fixed_length_value,
+      sizeof(spp_credit_char_init_value),   // max length
+      sizeof(spp_credit_char_init_value),   // initial value length
+      (const uint8_t*) &spp_credit_char_init_value,
+      &_gatt_db.spp_credit_characteristic_handle);
+    app_assert_status(sc);
+  }
+
   // Start the SPP service
   sc = sl_bt_gattdb_start_service(
     _gatt_db.session_id,
@@ -381,17 +431,18 @@ void sppBLEClass::stop_advertising()
 // BLE: Connections
 void sppBLEClass::print_connections()
 {
-  for (const auto & it : _connections) {
-    log("conn:0x%02X bonding:0x%02X %s addr:%02X:%02X:%02X:%02X:%02X:%02X\n",
-        it.conn,
-        it.bonding,
-        it.is_master ? "master" : "slave",
-        it.addr.addr[5],
-        it.addr.addr[4],
-        it.addr.addr[3],
-        it.addr.addr[2],
-        it.addr.addr[1],
-        it.addr.addr[0]);
+  for (size_t i = 0; i < _connection_count; ++i) {
+    SPP_LOG(INFO, "conn:0x%02X bonding:0x%02X %s",
+            _connections[i].conn,
+            _connections[i].bonding,
+            _connections[i].is_master ? "master" : "slave");
+    SPP_LOG(INFO, "addr:%02X:%02X:%02X:%02X:%02X:%02X",
+            _connections[i].addr.addr[5],
+            _connections[i].addr.addr[4],
+            _connections[i].addr.addr[3],
+            _connections[i].addr.addr[2],
+            _connections[i].addr.addr[1],
+            _connections[i].addr.addr[0]);
   }
 }
 
@@ -402,11 +453,11 @@ bool sppBLEClass::add_connection(
   const bd_addr &addr
   )
 {
-  if (_connections.size() >= SL_BT_CONFIG_MAX_CONNECTIONS) {
+  if (_connection_count >= SL_BT_CONFIG_MAX_CONNECTIONS) {
     return false;
   }
 
-  _connections.emplace_back(is_master, conn, bonding, addr);
+  _connections[_connection_count++] = { is_master, conn, bonding, addr };
 
   return true;
 }
@@ -415,9 +466,10 @@ void sppBLEClass::close_connection(
   uint8_t conn
   )
 {
-  for (auto it = _connections.begin(); it != _connections.end(); ++it) {
-    if (it->conn == conn) {
-      _connections.erase(it);
+  for (size_t i = 0; i < _connection_count; ++i) {
+    if (_connections[i].conn == conn) {
+      // Keep the table packed, the order of the connections is not relevant
+      _connections[i] = _connections[--_connection_count];
       return;
     }
   }
@@ -457,24 +509,50 @@ size_t sppBLEClass::send_mesg(
   return send_data(conn, strlen(message), (uint8_t *)message);
 }
 
+void sppBLEClass::set_data_characteristic_handle(uint16_t handle)
+{
+  _gatt_db.spp_data_characteristic_handle = handle;
+}
+
+uint16_t sppBLEClass::get_data_characteristic_handle()
+{
+  return _gatt_db.spp_data_characteristic_handle;
+}
+
+int sppBLEClass::tx_available()
+{
+  return _tx_buf.available();
+}
+
+void sppBLEClass::send_write_response(
+  uint8_t conn,
+  uint16_t characteristic,
+  uint8_t att_error
+  )
+{
+  sl_bt_gatt_server_send_user_write_response(conn, characteristic, att_error);
+}
+
 size_t sppBLEClass::transfer_outgoing_data(bool safe)
 {
-  uint8_t local_buf[_max_ble_transfer_size];
-  size_t local_buf_idx = 0;
+  size_t frame_len = 0;
 
+  // The Tx frame is shared, so it is sent while the Tx mutex is held
   if (safe) {
     xSemaphoreTake(_tx_buf_mutex, portMAX_DELAY);
   }
 
-  for (; local_buf_idx < _max_ble_transfer_size && _tx_buf.available(); ++local_buf_idx) {
-    local_buf[local_buf_idx] = _tx_buf.read_char();
+  for (; frame_len < _max_ble_transfer_size && _tx_buf.available(); ++frame_len) {
+    _tx_frame[frame_len] = _tx_buf.read_char();
   }
 
+  size_t sent = send_data(0xFF, frame_len, _tx_frame);
+
   if (safe) {
     xSemaphoreGive(_tx_buf_mutex);
   }
 
-  return send_data(0xFF, local_buf_idx, local_buf);
+  return sent;
 }
 
 // Log
@@ -498,21 +576,6 @@ const char *sppBLEClass::get_log_tag()
   return _log.tag;
 }
 
-void sppBLEClass::log(const char* fmt, ...)
-{
-  if (!_log.enable) {
-    return;
-  }
-
-  char message[_printf_buffer_size];
-  va_list args;
-  va_start(args, fmt);
-  vsnprintf(message, sizeof(message), fmt, args);
-  va_end(args);
-  Serial.print(_log.tag);
-  Serial.println(message);
-}
-
 // BLE
 void sppBLEClass::onBLEEvent(void (*user_onbleevent_callback)(sl_bt_msg_t*))
 {
@@ -544,7 +607,7 @@ void sppBLEClass::handle_boot_event(sl_bt_msg_t *evt)
     return;
   }
 
-  log("BLE stack booted");
+  SPP_LOG(INFO, "BLE stack booted");
 
   _ble_stack_booted = true;
   if (_state == state::ST_BOOT) {
@@ -562,7 +625,7 @@ void sppBLEClass::handle_conn_open(sl_bt_msg_t *evt)
 
   sl_bt_evt_connection_opened_t *ev_conn = &evt->data.evt_connection_opened;
 
-  log("BLE connection 0x%02X opened", ev_conn->connection);
+  SPP_LOG(INFO, "BLE connection 0x%02X opened", ev_conn->connection);
 
   if (!add_connection(false,
                       ev_conn->connection,
@@ -571,12 +634,18 @@ void sppBLEClass::handle_conn_open(sl_bt_msg_t *evt)
     return;
   }
 
-  if (_connections.size() < SL_BT_CONFIG_MAX_CONNECTIONS) {
+  if (_connection_count < SL_BT_CONFIG_MAX_CONNECTIONS) {
     start_advertising();
   }
 
   _state = state::ST_READY;
 
+  // The credit counts the bytes of the new connection
+  xSemaphoreTake(_rx_buf_mutex, portMAX_DELAY);
+  _rx_flow.received = 0u;
+  xSemaphoreGive(_rx_buf_mutex);
+  update_credit(true);
+
   if (user_onconnect_callback) {
     user_onconnect_callback(ev_conn->connection);
   }
@@ -590,13 +659,21 @@ void sppBLEClass::handle_conn_close(sl_bt_msg_t *evt)
 
   sl_bt_evt_connection_closed_t *ev_conn = &evt->data.evt_connection_closed;
 
-  log("BLE connection 0x%02X closed", ev_conn->connection);
+  SPP_LOG(INFO, "BLE connection 0x%02X closed", ev_conn->connection);
 
   close_connection(ev_conn->connection);
 
-  if (_connections.empty()) {
+  // A held back write cannot be answered anymore
+  xSemaphoreTake(_rx_buf_mutex, portMAX_DELAY);
+  if (_rx_flow.pending && _rx_flow.pending_conn == ev_conn->connection) {
+    _rx_flow.pending = false;
+    _rx_stats.dropped += _rx_flow.pending_len;
+  }
+  xSemaphoreGive(_rx_buf_mutex);
+
+  if (_connection_count == 0u) {
     _state = state::ST_DISCONNECTED;
-  } else if (_connections.size() < SL_BT_CONFIG_MAX_CONNECTIONS) {
+  } else if (_connection_count < SL_BT_CONFIG_MAX_CONNECTIONS) {
     start_advertising();
   }
 
@@ -616,35 +693,206 @@ void sppBLEClass::handle_gatt_data_receive(sl_bt_msg_t *evt)
     return;
   }
 
-  log("GATT data received");
+  SPP_LOG(DEBUG, "GATT data received");
 
   uint8_t data_len = evt->data.evt_gatt_server_attribute_value.value.len;
   uint8_t *data = evt->data.evt_gatt_server_attribute_value.value.data;
 
-  if (_rx_buf.isFull()) {
+  xSemaphoreTake(_rx_buf_mutex, portMAX_DELAY);
+  size_t stored = store_rx_data(data, data_len);
+  xSemaphoreGive(_rx_buf_mutex);
+
+  if (stored < data_len) {
     // Overflow, Rx buffer is full, cannot store any additional data
-    log("Rx buffer overflow!");
+    SPP_LOG(WARN, "Rx buffer overflow!");
+  }
+}
+
+void sppBLEClass::handle_gatt_user_write(sl_bt_msg_t *evt)
+{
+  sl_bt_evt_gatt_server_user_write_request_t *req = &evt->data.evt_gatt_server_user_write_request;
+
+  if (_gatt_db.spp_data_characteristic_handle != req->characteristic) {
     return;
   }
 
+  SPP_LOG(DEBUG, "GATT data received");
+
+  bool needs_response = (req->att_opcode == sl_bt_gatt_server_write_request);
+  uint8_t att_error = 0u;
+
   xSemaphoreTake(_rx_buf_mutex, portMAX_DELAY);
 
-  uint8_t buffered_bytes = 0u;
-  for (uint8_t i = 0; i < data_len; i++) {
-    _rx_buf.store_char(data[i]);
-    buffered_bytes++;
-    if (_rx_buf.isFull()) {
-      // Overflow, Rx buffer is full, cannot store any additional data
+  if (needs_response && (size_t)_rx_buf.availableForStore() < req->value.len) {
+    if (!_rx_flow.pending) {
+      // Backpressure: hold the response until read() makes room
+      _rx_flow.pending = true;
+      _rx_flow.pending_conn = req->connection;
+      _rx_flow.pending_len = req->value.len;
+      memcpy(_rx_flow.pending_data, req->value.data, req->value.len);
+      _rx_stats.deferred_writes++;
       xSemaphoreGive(_rx_buf_mutex);
-      log("Rx buffer overflow!");
       return;
     }
+    // Insufficient resources, another write is already held back
+    att_error = ATT_ERR_INSUFFICIENT_RESOURCES;
+    _rx_stats.dropped += req->value.len;
+    _rx_stats.overflows++;
+  } else {
+    store_rx_data(req->value.data, req->value.len);
+  }
+
+  xSemaphoreGive(_rx_buf_mutex);
+
+  if (needs_response) {
+    send_write_response(req->connection, req->characteristic, att_error);
+  }
+}
+
+void sppBLEClass::handle_characteristic_status(sl_bt_msg_t *evt)
+{
+  sl_bt_evt_gatt_server_characteristic_status_t *status = &evt->data.evt_gatt_server_characteristic_status;
+
+  // Send the current credit when the peer subscribes to it
+  if (status->characteristic == _gatt_db.spp_credit_characteristic_handle
+      && status->status_flags == sl_bt_gatt_server_client_config
+      && (status->client_config_flags & sl_bt_gatt_notification)) {
+    update_credit(true);
+  }
+}
+
+uint32_t sppBLEClass::get_rx_timestamp()
+{
+  return _rx_stamps.last_us;
+}
+
+size_t sppBLEClass::store_rx_data(const uint8_t *data, size_t len)
+{
+  size_t space = _rx_buf.availableForStore();
+  size_t stored = len < space ? len : space;
+
+  for (size_t i = 0; i < stored; ++i) {
+    _rx_buf.store_char(data[i]);
+  }
+
+  _rx_flow.received += stored;
+  _rx_stats.received += stored;
+
+  if (stored) {
+    rx_stamps_t &stamps = _rx_stamps;
+    if (stamps.head - stamps.tail >= SPP_BLE_RX_STAMP_COUNT) {
+      stamps.tail++;
+    }
+    stamps.stored += stored;
+    stamps.entries[stamps.head % SPP_BLE_RX_STAMP_COUNT] = { stamps.stored, (uint32_t)micros() };
+    stamps.head++;
+  }
+  if (stored < len) {
+    _rx_stats.dropped += len - stored;
+    _rx_stats.overflows++;
   }
 
+  return stored;
+}
+
+void sppBLEClass::complete_pending_write()
+{
+  if ((size_t)_rx_buf.availableForStore() < _rx_flow.pending_len) {
+    return;
+  }
+
+  store_rx_data(_rx_flow.pending_data, _rx_flow.pending_len);
+  _rx_flow.pending = false;
+
+  send_write_response(_rx_flow.pending_conn,
+                      _gatt_db.spp_data_characteristic_handle,
+                      0u);
+}
+
+void sppBLEClass::update_credit(bool force)
+{
+  if (_gatt_db.spp_credit_characteristic_handle == 0xFFFF) {
+    return;
+  }
+
+  // Received bytes plus free space: constant while receiving, grows on read()
+  uint32_t credit = _rx_flow.received + (_data_buffer_size - _rx_buf.available());
+
+  if (!force && credit - _rx_flow.advertised < _credit_step) {
+    return;
+  }
+  _rx_flow.advertised = credit;
+  _rx_stats.credit_updates++;
+
+  sl_bt_gatt_server_write_attribute_value(_gatt_db.spp_credit_characteristic_handle,
+                                          0u,
+                                          sizeof(credit),
+                                          (const uint8_t*) &credit);
+  sl_bt_gatt_server_notify_all(_gatt_db.spp_credit_characteristic_handle,
+                               sizeof(credit),
+                               (const uint8_t*) &credit);
+}
+
+void sppBLEClass::set_rx_flow_control(rx_flow_control_t mode)
+{
+  if (_gatt_db.initialized) {
+    // The GATT DB depends on the mode
+    return;
+  }
+  _rx_flow.mode = mode;
+}
+
+sppBLEClass::rx_flow_control_t sppBLEClass::get_rx_flow_control()
+{
+  return _rx_flow.mode;
+}
+
+const sppBLEClass::rx_stats_t &sppBLEClass::get_rx_stats()
+{
+  return _rx_stats;
+}
+
+void sppBLEClass::reset_rx_stats()
+{
+  xSemaphoreTake(_rx_buf_mutex, portMAX_DELAY);
+  _rx_stats = { 0u, 0u, 0u, 0u, 0u };
   xSemaphoreGive(_rx_buf_mutex);
 }
 
+void sppBLEClass::print_rx_stats(Print &out)
+{
+  out.print("RX received:");
+  out.print(_rx_stats.received);
+  out.print(" dropped:");
+  out.print(_rx_stats.dropped);
+  out.print(" overflows:");
+  out.print(_rx_stats.overflows);
+  out.print(" deferred_writes:");
+  out.print(_rx_stats.deferred_writes);
+  out.print(" credit_updates:");
+  out.println(_rx_stats.credit_updates);
+}
+
 void sppBLEClass::handle_ble_event(sl_bt_msg_t *evt)
+{
+  if (!evt) {
+    return;
+  }
+
+  uint32_t start = micros();
+
+  dispatch_ble_event(evt);
+
+  uint32_t elapsed = micros() - start;
+  event_stats_t &stats = _event_stats[event_type(evt->header)];
+  stats.count++;
+  stats.total_us += elapsed;
+  if (elapsed > stats.max_us) {
+    stats.max_us = elapsed;
+  }
+}
+
+void sppBLEClass::dispatch_ble_event(sl_bt_msg_t *evt)
 {
   if (user_onbleevent_callback) {
     user_onbleevent_callback(evt);
@@ -667,10 +915,199 @@ void sppBLEClass::handle_ble_event(sl_bt_msg_t *evt)
       handle_gatt_data_receive(evt);
       break;
 
+    case sl_bt_evt_gatt_server_user_write_request_id:
+      handle_gatt_user_write(evt);
+      break;
+
+    case sl_bt_evt_gatt_server_characteristic_status_id:
+      handle_characteristic_status(evt);
+      break;
+
     default:
-      log("BLE event: 0x%x", SL_BT_MSG_ID(evt->header));
+      SPP_LOG(DEBUG, "BLE event: 0x%x", SL_BT_MSG_ID(evt->header));
+      break;
+  }
+}
+
+// BLE:Events
+bool sppBLEClass::set_deferred_events(event_entry_t *queue, size_t size)
+{
+  if (_state != state::ST_NOT_STARTED) {
+    return false;
+  }
+  if (queue && (size < 2u * _event_reserve || (size & (size - 1u)))) {
+    return false;
+  }
+
+  _event_queue = queue;
+  _event_queue_size = queue ? size : 0u;
+  _event_write_pos = 0u;
+  _event_read_pos = 0u;
+  return true;
+}
+
+bool sppBLEClass::get_deferred_events()
+{
+  return _event_queue != nullptr;
+}
+
+void sppBLEClass::reject_ble_event(sl_bt_msg_t *evt)
+{
+  // A dropped request is answered with an error, so the peer does not wait
+  // for the ATT timeout and can retry. Only stack calls, no shared state.
+  uint16_t sent_len;
+  switch (SL_BT_MSG_ID(evt->header)) {
+    case sl_bt_evt_gatt_server_user_read_request_id:
+      sl_bt_gatt_server_send_user_read_response(evt->data.evt_gatt_server_user_read_request.connection,
+                                                evt->data.evt_gatt_server_user_read_request.characteristic,
+                                                ATT_ERR_INSUFFICIENT_RESOURCES, 0, nullptr, &sent_len);
+      break;
+    case sl_bt_evt_gatt_server_user_write_request_id:
+      sl_bt_gatt_server_send_user_write_response(evt->data.evt_gatt_server_user_write_request.connection,
+                                                 evt->data.evt_gatt_server_user_write_request.characteristic,
+                                                 ATT_ERR_INSUFFICIENT_RESOURCES);
+      break;
+    default:
+      break;
+  }
+}
+
+bool sppBLEClass::enqueue_ble_event(sl_bt_msg_t *evt)
+{
+  if (!_event_queue || !evt) {
+    return false;
+  }
+
+  // Deferred mode never falls back to synchronous handling. All events are
+  // queued, the ones sppBLE does not handle still reach onBLEEvent().
+  size_t len = sizeof(evt->header) + SL_BT_MSG_LEN(evt->header);
+  uint32_t write_pos = _event_write_pos.load(std::memory_order_relaxed);
+  uint32_t used = write_pos - _event_read_pos.load(std::memory_order_acquire);
+
+  // The other events leave room for the connection events
+  uint32_t id = SL_BT_MSG_ID(evt->header);
+  bool connection_event = id == sl_bt_evt_system_boot_id
+                          || id == sl_bt_evt_connection_opened_id
+                          || id == sl_bt_evt_connection_closed_id;
+  uint32_t limit = connection_event ? _event_queue_size : _event_queue_size - _event_reserve;
+
+  if (len > event_size || used >= limit) {
+    _event_queue_stats.dropped++;
+    reject_ble_event(evt);
+    return true;
+  }
+
+  event_entry_t &entry = _event_queue[write_pos & (_event_queue_size - 1u)];
+  entry.enqueued_us = micros();
+  memcpy(entry.evt.data, evt, len);
+
+  _event_write_pos.store(write_pos + 1u, std::memory_order_release);
+
+  if (used + 1u > _event_queue_stats.high_water) {
+    _event_queue_stats.high_water = used + 1u;
+  }
+
+  return true;
+}
+
+size_t sppBLEClass::process_events(size_t max_events)
+{
+  size_t count = 0;
+  if (!_event_queue) {
+    return count;
+  }
+
+  // Events queued meanwhile wait for the next call, the work stays bounded
+  uint32_t end_pos = _event_write_pos.load(std::memory_order_acquire);
+
+  for (; count < max_events; ++count) {
+    uint32_t read_pos = _event_read_pos.load(std::memory_order_relaxed);
+    if (read_pos == end_pos) {
       break;
+    }
+
+    event_entry_t &entry = _event_queue[read_pos & (_event_queue_size - 1u)];
+
+    uint32_t delay = micros() - entry.enqueued_us;
+    if (delay > _event_queue_stats.max_delay_us) {
+      _event_queue_stats.max_delay_us = delay;
+    }
+
+    handle_ble_event((sl_bt_msg_t *)entry.evt.data);
+
+    _event_read_pos.store(read_pos + 1u, std::memory_order_release);
   }
+
+  return count;
+}
+
+sppBLEClass::event_type_t sppBLEClass::event_type(uint32_t header)
+{
+  switch (SL_BT_MSG_ID(header)) {
+    case sl_bt_evt_system_boot_id:
+      return EVT_BOOT;
+    case sl_bt_evt_connection_opened_id:
+      return EVT_CONN_OPENED;
+    case sl_bt_evt_connection_closed_id:
+      return EVT_CONN_CLOSED;
+    case sl_bt_evt_gatt_server_attribute_value_id:
+      return EVT_GATT_VALUE;
+    case sl_bt_evt_gatt_server_user_read_request_id:
+      return EVT_GATT_USER_READ;
+    case sl_bt_evt_gatt_server_user_write_request_id:
+      return EVT_GATT_USER_WRITE;
+    default:
+      return EVT_OTHER;
+  }
+}
+
+const sppBLEClass::event_stats_t &sppBLEClass::get_event_stats(event_type_t type)
+{
+  return _event_stats[type < EVT_TYPE_COUNT ? type : EVT_OTHER];
+}
+
+const sppBLEClass::event_queue_stats_t &sppBLEClass::get_event_queue_stats()
+{
+  return _event_queue_stats;
+}
+
+void sppBLEClass::reset_event_stats()
+{
+  for (auto & it : _event_stats) {
+    it = { 0u, 0u, 0u };
+  }
+  _event_queue_stats = { 0u, 0u, 0u };
+}
+
+void sppBLEClass::print_event_stats(Print &out)
+{
+  static const char *const names[EVT_TYPE_COUNT] = {
+    "boot", "conn_opened", "conn_closed", "gatt_value", "user_read", "user_write", "other",
+  };
+
+  // count, handling time avg/max [us]
+  for (size_t i = 0; i < EVT_TYPE_COUNT; ++i) {
+    const event_stats_t &it = _event_stats[i];
+    out.print("EVT ");
+    out.print(names[i]);
+    out.print(" count:");
+    out.print(it.count);
+    out.print(" avg:");
+    out.print(it.count ? it.total_us / it.count : 0u);
+    out.print(" max:");
+    out.println(it.max_us);
+  }
+
+  out.print("EVTQ ");
+  out.print(_event_queue ? "deferred" : "sync");
+  out.print(" high_water:");
+  out.print(_event_queue_stats.high_water);
+  out.print('/');
+  out.print(_event_queue_size);
+  out.print(" dropped:");
+  out.print(_event_queue_stats.dropped);
+  out.print(" max_delay:");
+  out.println(_event_queue_stats.max_delay_us);
 }
 
 void sppBLEClass::begin(const char* ble_name)
@@ -679,6 +1116,13 @@ void sppBLEClass::begin(const char* ble_name)
     return;
   }
 
+  // The name is not truncated, a name which does not fit is rejected
+  size_t name_size = strlen(ble_name) + (_gatt_db.device_name_support_uuid ? 7u : 0u) + 1u;
+  if (name_size > _max_ble_name_size) {
+    SPP_LOG(ERROR, "BLE device name too long: %u B, max. %u B", name_size, _max_ble_name_size);
+    return;
+  }
+
   set_ble_name(ble_name);
   init_gattdb();
 
@@ -701,19 +1145,21 @@ void sppBLEClass::end()
   // Close all connection
   if (_state == state::ST_READY) {
     sl_status_t sc;
-    for (const auto & it : _connections) {
-      sc = sl_bt_connection_close(it.conn);
+    for (size_t i = 0; i < _connection_count; ++i) {
+      sc = sl_bt_connection_close(_connections[i].conn);
       if (sc != SL_STATUS_OK) {
         xSemaphoreGive(_tx_buf_mutex);
         xSemaphoreGive(_rx_buf_mutex);
-        log("Could not close connection");
+        SPP_LOG(ERROR, "Could not close connection");
         return;
       }
     }
-    _connections.clear();
+    _connection_count = 0u;
   }
 
   _rx_buf.clear();
+  _rx_stamps.tail = _rx_stamps.head;
+  _rx_stamps.consumed = _rx_stamps.stored;
   _tx_buf.clear();
 
   _state = state::ST_NOT_STARTED;
@@ -729,6 +1175,8 @@ sppBLEClass sppBLE;
  *****************************************************************************/
 void sl_bt_on_event(sl_bt_msg_t* evt)
 {
-  // Pass all the stack events to ezBLE
-  sppBLE.handle_ble_event(evt);
+  // Pass all the stack events to ezBLE, deferred to the application if enabled
+  if (!sppBLE.enqueue_ble_event(evt)) {
+    sppBLE.handle_ble_event(evt);
+  }
 }
@@ -41,7 +41,25 @@ extern "C" {
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include <SimpleFOC.h>
-#include <vector>
+#include <atomic>
+#include "deferredLog.h"
+
+// Static buffer sizes, override with compiler flags to shrink the RAM usage
+#ifndef SPP_BLE_MAX_NAME_SIZE
+#define SPP_BLE_MAX_NAME_SIZE     32u   // Device name incl. the "_xxyyzz" suffix
+#endif
+#ifndef SPP_BLE_MAX_TRANSFER_SIZE
+#define SPP_BLE_MAX_TRANSFER_SIZE 250u  // SPP data characteristic length
+#endif
+#ifndef SPP_BLE_DATA_BUFFER_SIZE
+#define SPP_BLE_DATA_BUFFER_SIZE  512u  // Rx and Tx ring buffer size each
+#endif
+#ifndef SPP_BLE_EVENT_QUEUE_SIZE
+#define SPP_BLE_EVENT_QUEUE_SIZE  8u    // Deferred BLE events
+#endif
+#ifndef SPP_BLE_RX_STAMP_COUNT
+#define SPP_BLE_RX_STAMP_COUNT    8u    // Timestamped writes in the Rx buffer
+#endif
 
 // SPP service UUID: 4880c12c-fdcb-4077-8920-a450d7f9b907
 const uuid_128 spp_service_uuid = {
@@ -53,6 +71,11 @@ const uuid_128 spp_data_characteristic_uuid = {
   .data = { 0xd6, 0x58, 0xd6, 0x21, 0xbc, 0x55, 0x81, 0x9f, 0x42, 0x44, 0x71, 0x6d, 0xc4, 0x6e, 0xc2, 0xfe, }
 };
 
+// SPP credit UUID: ab7d4efe-f450-46fa-b74e-abd84986c2e5
+const uuid_128 spp_credit_characteristic_uuid = {
+  .data = { 0xe5, 0xc2, 0x86, 0x49, 0xd8, 0xab, 0x4e, 0xb7, 0xfa, 0x46, 0x50, 0xf4, 0xfe, 0x4e, 0x7d, 0xab, }
+};
+
 class sppBLEClass: public Stream {
 public:
   sppBLEClass();
@@ -75,6 +98,8 @@ public:
   void onCheckSendCondition(bool (*user_checksendcondition_callback)(size_t, const uint8_t*, size_t));
 
   // BLE
+  // Not started when the name, with the "_xxyyzz" suffix when enabled, and
+  // the terminating NUL do not fit in SPP_BLE_MAX_NAME_SIZE
   virtual void begin(const char* ble_name = "motor");
   virtual void end();
 
@@ -84,6 +109,70 @@ public:
   void onConnect(void (*user_onconnect_callback)(uint8_t));
   void onDisconnect(void (*user_ondisconnect_callback)(uint8_t));
 
+  // BLE:Events
+  // In deferred mode the stack events are queued by sl_bt_on_event() and
+  // handled by process_events(), called from the application. All events
+  // are queued, so the onBLEEvent() callback sees the link events (MTU,
+  // connection parameters, PHY) too. An event which does not fit is dropped
+  // and counted, never handled in the stack context, so the events keep
+  // their order.
+
+  // Event header and payload, large enough for a full SPP data write
+  static const size_t event_size = sizeof(uint32_t) + 8u + SPP_BLE_MAX_TRANSFER_SIZE;
+
+  struct event_entry_t {
+    uint32_t enqueued_us;
+    union {
+      uint32_t header;
+      uint8_t data[event_size];
+    } evt;
+  };
+
+  // The queue is provided by the application, so it only takes RAM when
+  // deferred mode is used. The size must be a power of 2, min. 4. A null
+  // queue selects synchronous handling. Call before begin().
+  bool set_deferred_events(event_entry_t *queue, size_t size);
+  template <size_t size>
+  bool set_deferred_events(event_entry_t (&queue)[size])
+  {
+    return set_deferred_events(queue, size);
+  }
+  bool get_deferred_events();
+
+  // Returns false if the event has to be handled synchronously
+  bool enqueue_ble_event(sl_bt_msg_t *evt);
+
+  // Handle the events queued before the call, at most max_events
+  size_t process_events(size_t max_events = SIZE_MAX);
+
+  enum event_type_t {
+    EVT_BOOT = 0,
+    EVT_CONN_OPENED,
+    EVT_CONN_CLOSED,
+    EVT_GATT_VALUE,
+    EVT_GATT_USER_READ,
+    EVT_GATT_USER_WRITE,
+    EVT_OTHER,
+    EVT_TYPE_COUNT,
+  };
+
+  struct event_stats_t {
+    uint32_t count;
+    uint32_t total_us;  // Handling time
+    uint32_t max_us;
+  };
+
+  struct event_queue_stats_t {
+    uint32_t high_water;
+    uint32_t dropped;       // Queue full or event too large
+    uint32_t max_delay_us;  // Time spent in the queue
+  };
+
+  const event_stats_t &get_event_stats(event_type_t type);
+  const event_queue_stats_t &get_event_queue_stats();
+  void reset_event_stats();
+  void print_event_stats(Print &out);
+
   // BLE:GATT DB
   void set_ble_name(const char *ble_name);
   const char *get_ble_name();
@@ -120,6 +209,45 @@ public:
 
   virtual size_t send_mesg(uint8_t connection, const char *message);
 
+  uint16_t get_data_characteristic_handle();
+
+  // BLE:SPP flow control, select the mode before begin()
+  //  RX_FLOW_CREDIT: the credit characteristic holds the total number of
+  //    bytes the peer may send in the connection, notified as it grows
+  //  RX_FLOW_WRITE_RESPONSE: writes with response are answered only when
+  //    they fit in the Rx buffer
+  enum rx_flow_control_t {
+    RX_FLOW_NONE = 0,
+    RX_FLOW_CREDIT,
+    RX_FLOW_WRITE_RESPONSE,
+  };
+
+  void set_rx_flow_control(rx_flow_control_t mode);
+  rx_flow_control_t get_rx_flow_control();
+
+  struct rx_stats_t {
+    uint32_t received;        // [B]
+    uint32_t dropped;         // [B]
+    uint32_t overflows;       // Writes which did not fit
+    uint32_t deferred_writes; // Write responses held back
+    uint32_t credit_updates;
+  };
+
+  const rx_stats_t &get_rx_stats();
+  void reset_rx_stats();
+  void print_rx_stats(Print &out);
+
+  // Time [us] the write holding the last byte returned by read() was
+  // received in handle_gatt_data_receive()
+  uint32_t get_rx_timestamp();
+
+protected:
+  // Used by derived replay targets, which have no GATT DB of their own
+  void set_data_characteristic_handle(uint16_t handle);
+  int tx_available();
+
+  virtual void send_write_response(uint8_t connection, uint16_t characteristic, uint8_t att_error);
+
 private:
   enum state {
     ST_NOT_STARTED = 0,
@@ -130,13 +258,10 @@ private:
   state _state { ST_NOT_STARTED };
 
   // Log
-  static const uint8_t _printf_buffer_size = 64u;
-
   struct log_t {
     bool enable;
     const char *tag;
   };
-  void log(const char* fmt, ...);
 
   log_t _log { false, "[sppBLE] " };
 
@@ -148,12 +273,31 @@ private:
   void handle_conn_open(sl_bt_msg_t *evt);
   void handle_conn_close(sl_bt_msg_t *evt);
   void handle_gatt_data_receive(sl_bt_msg_t *evt);
+  void handle_gatt_user_write(sl_bt_msg_t *evt);
+  void handle_characteristic_status(sl_bt_msg_t *evt);
+  void dispatch_ble_event(sl_bt_msg_t *evt);
 
   bool _ble_stack_booted;
   void (*user_onbleevent_callback)(sl_bt_msg_t*);
   void (*user_onconnect_callback)(uint8_t connection);
   void (*user_ondisconnect_callback)(uint8_t connection);
 
+  // BLE:Events
+  static event_type_t event_type(uint32_t header);
+
+  static void reject_ble_event(sl_bt_msg_t *evt);
+
+  // Slots kept free for the boot and connection events
+  static const uint32_t _event_reserve = 2u;
+
+  event_entry_t *_event_queue { nullptr };
+  uint32_t _event_queue_size { 0u };
+  std::atomic < uint32_t > _event_write_pos { 0u };
+  std::atomic < uint32_t > _event_read_pos { 0u };
+
+  event_stats_t _event_stats[EVT_TYPE_COUNT];
+  event_queue_stats_t _event_queue_stats { 0u, 0u, 0u };
+
   // BLE:GATT DB
   struct gatt_db_t {
     bool initialized;
@@ -164,12 +308,13 @@ private:
     uint16_t spp_data_characteristic_handle;
     const char* device_name;
     bool device_name_support_uuid;
+    uint16_t spp_credit_characteristic_handle;
   };
 
   void init_gattdb();
 
-  static const size_t _max_ble_name_size = 512u;
-  gatt_db_t _gatt_db { false, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, "unknown", true };
+  static const size_t _max_ble_name_size = SPP_BLE_MAX_NAME_SIZE;
+  gatt_db_t _gatt_db { false, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, "unknown", true, 0xFFFF };
   void (*user_oninitgattdb_callback)(uint16_t);
 
   // BLE:ADV
@@ -195,14 +340,6 @@ private:
     uint8_t conn;
     uint8_t bonding;
     bd_addr addr;
-
-    connection_t(
-      bool is_master,
-      uint8_t conn,
-      uint8_t bonding,
-      const bd_addr &addr
-      ) : is_master(is_master), conn(conn), bonding(bonding), addr(addr) {
-    }
   };
 
   bool add_connection(
@@ -214,11 +351,12 @@ private:
   void close_connection(
     uint8_t conn);
 
-  std::vector < connection_t > _connections;
+  connection_t _connections[SL_BT_CONFIG_MAX_CONNECTIONS];
+  size_t _connection_count { 0u };
 
   // BLE:SPP
-  static const uint16_t _max_ble_transfer_size = 250u;
-  static const size_t _data_buffer_size = 512u;
+  static const uint16_t _max_ble_transfer_size = SPP_BLE_MAX_TRANSFER_SIZE;
+  static const size_t _data_buffer_size = SPP_BLE_DATA_BUFFER_SIZE;
 
   RingBufferN < _data_buffer_size > _rx_buf;
   RingBufferN < _data_buffer_size > _tx_buf;
@@ -228,7 +366,48 @@ private:
   SemaphoreHandle_t _tx_buf_mutex;
   StaticSemaphore_t _tx_buf_mutex_buf;
 
+  uint8_t _tx_frame[_max_ble_transfer_size];
   size_t transfer_outgoing_data(bool safe = true);
+
+  // BLE:SPP flow control
+  static const uint32_t _credit_step = _data_buffer_size / 4u;
+
+  struct rx_flow_t {
+    rx_flow_control_t mode;
+    uint32_t received;        // Bytes received in the connection
+    uint32_t advertised;      // Last advertised credit
+    bool pending;             // Write request waiting for Rx space
+    uint8_t pending_conn;
+    uint16_t pending_len;
+    uint8_t pending_data[_max_ble_transfer_size];
+  };
+
+  rx_flow_t _rx_flow { RX_FLOW_NONE, 0u, 0u, false, 0u, 0u, { 0u } };
+  rx_stats_t _rx_stats { 0u, 0u, 0u, 0u, 0u };
+
+  // Receive time of the writes in the Rx buffer, by the stored byte count
+  // at their end. The oldest is dropped when more writes are buffered.
+  struct rx_stamp_t {
+    uint32_t end;
+    uint32_t time_us;
+  };
+
+  struct rx_stamps_t {
+    rx_stamp_t entries[SPP_BLE_RX_STAMP_COUNT];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t stored;    // [B]
+    uint32_t consumed;  // [B]
+    uint32_t last_us;
+  };
+
+  rx_stamps_t _rx_stamps {};
+
+  // Callers hold the Rx mutex
+  size_t store_rx_data(const uint8_t *data, size_t len);
+  void complete_pending_write();
+
+  void update_credit(bool force);
 };
 
 extern sppBLEClass sppBLE;